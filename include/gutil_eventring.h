@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GUTIL_EVENTRING_H
+#define GUTIL_EVENTRING_H
+
+#include "gutil_types.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Thread-safe ring buffer for passing data from worker threads to
+ * a GLib main loop. Producers can put data from any thread, the
+ * consumer receives everything accumulated so far in one callback
+ * from the GSource created by gutil_event_ring_source_new().
+ *
+ * The consumer is woken up (via eventfd) only when the ring goes
+ * from empty to non-empty, no matter how many elements get added
+ * before the consumer gets around to handling them.
+ *
+ * The free function (if any) is invoked for each element after the
+ * callback returns, and for the elements remaining in the ring when
+ * the last reference to it is released. There should be only one
+ * source per ring.
+ *
+ * Since 1.0.82
+ */
+
+typedef
+void
+(*GUtilEventRingFunc)(
+    GUtilEventRing* ring,
+    gpointer* data,
+    guint count,
+    gpointer user_data);
+
+GUtilEventRing*
+gutil_event_ring_new(
+    gint max_size,
+    GDestroyNotify free_func);
+
+GUtilEventRing*
+gutil_event_ring_ref(
+    GUtilEventRing* ring);
+
+void
+gutil_event_ring_unref(
+    GUtilEventRing* ring);
+
+gint
+gutil_event_ring_size(
+    GUtilEventRing* ring);
+
+gboolean
+gutil_event_ring_put(
+    GUtilEventRing* ring,
+    gpointer data);
+
+guint
+gutil_event_ring_put_batch(
+    GUtilEventRing* ring,
+    gpointer* data,
+    guint count);
+
+GSource*
+gutil_event_ring_source_new(
+    GUtilEventRing* ring,
+    GUtilEventRingFunc func,
+    gpointer user_data,
+    GDestroyNotify destroy);
+
+guint
+gutil_event_ring_add_handler(
+    GUtilEventRing* ring,
+    GUtilEventRingFunc func,
+    gpointer user_data);
+
+G_END_DECLS
+
+#endif /* GUTIL_EVENTRING_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GUTIL_EWMA_H
+#define GUTIL_EWMA_H
+
+#include "gutil_history.h"
+
+/*
+ * Exponentially weighted moving average and variance. Unlike
+ * GUtilIntHistory, it doesn't keep the samples, only a few numbers.
+ *
+ * The time constant (tau) is in the same units as the values returned
+ * by GUtilHistoryTimeFunc, i.e. microseconds by default. A sample which
+ * arrives dt after the previous one gets the weight of 1 - exp(-dt/tau),
+ * which makes the result independent of how often the samples come in.
+ * The influence of a sample decays by the factor of e every tau.
+ *
+ * Just like with GUtilIntHistory, if the time hasn't changed since the
+ * last gutil_ewma_add() call, the last sample is replaced.
+ *
+ * Since 1.0.82
+ */
+
+G_BEGIN_DECLS
+
+GUtilEwma*
+gutil_ewma_new(
+    gint64 time_constant);
+
+GUtilEwma*
+gutil_ewma_new_full(
+    gint64 time_constant,
+    GUtilHistoryTimeFunc time_fn);
+
+GUtilEwma*
+gutil_ewma_ref(
+    GUtilEwma* ewma);
+
+void
+gutil_ewma_unref(
+    GUtilEwma* ewma);
+
+void
+gutil_ewma_clear(
+    GUtilEwma* ewma);
+
+double
+gutil_ewma_add(
+    GUtilEwma* ewma,
+    double value);
+
+double
+gutil_ewma_mean(
+    GUtilEwma* ewma,
+    double default_value);
+
+double
+gutil_ewma_variance(
+    GUtilEwma* ewma,
+    double default_value);
+
+G_END_DECLS
+
+#endif /* GUTIL_EWMA_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GUTIL_HISTOGRAM_H
+#define GUTIL_HISTOGRAM_H
+
+#include "gutil_types.h"
+
+/*
+ * Log-linear (HDR style) histogram of unsigned values, e.g. latencies
+ * in microseconds. Each power of 2 range is split into 2^precision_bits
+ * equal buckets, i.e. values are recorded with relative precision of
+ * 2^-precision_bits (values below 2^precision_bits are recorded exactly).
+ * Values above max_value end up in the last bucket. The count, sum, min
+ * and max are tracked exactly.
+ *
+ * Recording a value takes constant time. Histograms with the same
+ * parameters can be merged, e.g. after collecting them per thread.
+ * Percentiles return the highest value equivalent to the bucket, which
+ * is never less than the actual sample at that rank.
+ *
+ * The serialized form is a sequence of unsigned MBNs (see
+ * gutil_datapack.h), only non-empty buckets are stored.
+ *
+ * Since 1.0.82
+ */
+
+G_BEGIN_DECLS
+
+#define GUTIL_HISTOGRAM_MAX_PRECISION_BITS (16)
+
+GUtilHistogram*
+gutil_histogram_new(
+    guint64 max_value,
+    guint precision_bits);
+
+GUtilHistogram*
+gutil_histogram_ref(
+    GUtilHistogram* histogram);
+
+void
+gutil_histogram_unref(
+    GUtilHistogram* histogram);
+
+void
+gutil_histogram_clear(
+    GUtilHistogram* histogram);
+
+void
+gutil_histogram_add(
+    GUtilHistogram* histogram,
+    guint64 value);
+
+gboolean
+gutil_histogram_merge(
+    GUtilHistogram* histogram,
+    const GUtilHistogram* other);
+
+guint64
+gutil_histogram_count(
+    const GUtilHistogram* histogram);
+
+guint64
+gutil_histogram_min(
+    const GUtilHistogram* histogram);
+
+guint64
+gutil_histogram_max(
+    const GUtilHistogram* histogram);
+
+double
+gutil_histogram_mean(
+    const GUtilHistogram* histogram);
+
+guint64
+gutil_histogram_percentile(
+    const GUtilHistogram* histogram,
+    double percent);
+
+GBytes*
+gutil_histogram_encode(
+    const GUtilHistogram* histogram);
+
+GUtilHistogram*
+gutil_histogram_decode(
+    const GUtilData* data);
+
+G_END_DECLS
+
+#endif /* GUTIL_HISTOGRAM_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -60,6 +60,19 @@ G_BEGIN_DECLS
 #define GUTIL_HISTORY_SEC ((gint64)(G_USEC_PER_SEC))
 typedef gint64 (*GUtilHistoryTimeFunc)(void);
 
+/*
+ * Cheaper alternative to the default g_get_monotonic_time(), based on
+ * CLOCK_MONOTONIC_COARSE (where available). Its resolution is a few
+ * milliseconds (a kernel tick), which is usually good enough for the
+ * history. Pass it to gutil_int_history_new_full() and friends.
+ *
+ * Queries don't touch the entries until the oldest one is due to
+ * expire, whichever time function is used.
+ */
+gint64
+gutil_history_coarse_time(
+    void); /* Since 1.0.82 */
+
 GUtilIntHistory*
 gutil_int_history_new(
     int max_size,
@@ -96,11 +109,156 @@ gutil_int_history_add(
     GUtilIntHistory* history,
     int value);
 
+/*
+ * Despite the name, gutil_int_history_median() returns the time-weighted
+ * average. gutil_int_history_percentile() returns the nearest-rank
+ * percentile of the values in the window, i.e. 50 gives the real median.
+ * The first call sets up an index which is then maintained by
+ * gutil_int_history_add(), making each subsequent call O(log n).
+ */
 int
 gutil_int_history_median(
     GUtilIntHistory* history,
     int default_value);
 
+int
+gutil_int_history_percentile(
+    GUtilIntHistory* history,
+    guint percent,
+    int default_value); /* Since 1.0.82 */
+
+/* Amortized O(1) after the first call, like the percentile */
+int
+gutil_int_history_min(
+    GUtilIntHistory* history,
+    int default_value); /* Since 1.0.82 */
+
+int
+gutil_int_history_max(
+    GUtilIntHistory* history,
+    int default_value); /* Since 1.0.82 */
+
+/*
+ * The same thing for gint64 and double values. Since 1.0.82
+ *
+ * NaN is not added to the double history, gutil_double_history_add()
+ * just returns the current median.
+ */
+
+GUtilInt64History*
+gutil_int64_history_new(
+    int max_size,
+    gint64 max_interval);
+
+GUtilInt64History*
+gutil_int64_history_new_full(
+    int max_size,
+    gint64 max_interval,
+    GUtilHistoryTimeFunc time_fn);
+
+GUtilInt64History*
+gutil_int64_history_ref(
+    GUtilInt64History* history);
+
+void
+gutil_int64_history_unref(
+    GUtilInt64History* history);
+
+guint
+gutil_int64_history_size(
+    GUtilInt64History* history);
+
+gint64
+gutil_int64_history_interval(
+    GUtilInt64History* history);
+
+void
+gutil_int64_history_clear(
+    GUtilInt64History* history);
+
+gint64
+gutil_int64_history_add(
+    GUtilInt64History* history,
+    gint64 value);
+
+gint64
+gutil_int64_history_median(
+    GUtilInt64History* history,
+    gint64 default_value);
+
+gint64
+gutil_int64_history_percentile(
+    GUtilInt64History* history,
+    guint percent,
+    gint64 default_value);
+
+gint64
+gutil_int64_history_min(
+    GUtilInt64History* history,
+    gint64 default_value);
+
+gint64
+gutil_int64_history_max(
+    GUtilInt64History* history,
+    gint64 default_value);
+
+GUtilDoubleHistory*
+gutil_double_history_new(
+    int max_size,
+    gint64 max_interval);
+
+GUtilDoubleHistory*
+gutil_double_history_new_full(
+    int max_size,
+    gint64 max_interval,
+    GUtilHistoryTimeFunc time_fn);
+
+GUtilDoubleHistory*
+gutil_double_history_ref(
+    GUtilDoubleHistory* history);
+
+void
+gutil_double_history_unref(
+    GUtilDoubleHistory* history);
+
+guint
+gutil_double_history_size(
+    GUtilDoubleHistory* history);
+
+gint64
+gutil_double_history_interval(
+    GUtilDoubleHistory* history);
+
+void
+gutil_double_history_clear(
+    GUtilDoubleHistory* history);
+
+double
+gutil_double_history_add(
+    GUtilDoubleHistory* history,
+    double value);
+
+double
+gutil_double_history_median(
+    GUtilDoubleHistory* history,
+    double default_value);
+
+double
+gutil_double_history_percentile(
+    GUtilDoubleHistory* history,
+    guint percent,
+    double default_value);
+
+double
+gutil_double_history_min(
+    GUtilDoubleHistory* history,
+    double default_value);
+
+double
+gutil_double_history_max(
+    GUtilDoubleHistory* history,
+    double default_value);
+
 G_END_DECLS
 
 #endif /* GUTIL_HISTORY_H */
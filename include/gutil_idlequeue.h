@@ -40,10 +40,38 @@ G_BEGIN_DECLS
 /*
  * GUtilIdleQueue allows to queue idle callbacks, tag them, cancel
  * individual callbacks or all of them.
+ *
+ * The queue belongs to the thread running the default main context,
+ * only gutil_idle_queue_submit() can be called from other threads.
  */
 
 typedef gsize GUtilIdleQueueTag;
 
+/*
+ * Higher priority callbacks are invoked first, the callbacks of the
+ * same priority are invoked in the order in which they were queued.
+ * The priority of the idle source follows the highest priority
+ * callback in the queue, and each dispatch only invokes the callbacks
+ * of that priority. The functions which don't take the priority use
+ * the default one.
+ */
+typedef enum gutil_idle_queue_priority {
+    GUTIL_IDLE_QUEUE_PRIORITY_HIGH,     /* G_PRIORITY_HIGH_IDLE */
+    GUTIL_IDLE_QUEUE_PRIORITY_DEFAULT,  /* G_PRIORITY_DEFAULT_IDLE */
+    GUTIL_IDLE_QUEUE_PRIORITY_LOW       /* G_PRIORITY_LOW */
+} GUTIL_IDLE_QUEUE_PRIORITY; /* Since 1.0.82 */
+
+/*
+ * Histograms are in microseconds. The depth doesn't count the timed
+ * callbacks which aren't due yet.
+ */
+typedef struct gutil_idle_queue_stats {
+    GUtilHistogram* wait;               /* Time in the queue */
+    GUtilHistogram* run;                /* Time in the callback */
+    guint depth;                        /* Callbacks ready to run */
+    guint max_depth;                    /* Since enabled or reset */
+} GUtilIdleQueueStats; /* Since 1.0.82 */
+
 typedef
 void
 (*GUtilIdleFunc)(
@@ -92,6 +120,125 @@ gutil_idle_queue_add_tag_full(
     gpointer data,
     GFreeFunc free);
 
+/*
+ * Limits the number of callbacks and/or the time (in microseconds)
+ * spent per dispatch, zero means no limit. The rest is invoked on the
+ * next iteration(s) of the main loop. At least one callback is invoked
+ * per dispatch. By default, all callbacks queued before the dispatch
+ * are invoked in one go. gutil_idle_queue_get_budget_hits() tells how
+ * many times either limit has cut the dispatch short.
+ */
+void
+gutil_idle_queue_set_budget(
+    GUtilIdleQueue* queue,
+    guint max_items,
+    gint64 max_time); /* Since 1.0.82 */
+
+void
+gutil_idle_queue_get_budget_hits(
+    GUtilIdleQueue* queue,
+    guint* item_budget_hits,
+    guint* time_budget_hits); /* Since 1.0.82 */
+
+/*
+ * Only adds the callback if there's no pending callback with the same
+ * tag. Otherwise the new data is freed and FALSE is returned.
+ */
+gboolean
+gutil_idle_queue_add_unique(
+    GUtilIdleQueue* queue,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc free); /* Since 1.0.82 */
+
+/*
+ * Replaces the callback and the data of the oldest pending callback
+ * with the same tag, keeping its place in the queue, and frees the old
+ * data. If there's nothing to replace, adds the callback and returns
+ * FALSE.
+ */
+gboolean
+gutil_idle_queue_replace(
+    GUtilIdleQueue* queue,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc free); /* Since 1.0.82 */
+
+void
+gutil_idle_queue_add_priority(
+    GUtilIdleQueue* queue,
+    GUTIL_IDLE_QUEUE_PRIORITY priority,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc free); /* Since 1.0.82 */
+
+/*
+ * Timed callbacks become due after the delay (in milliseconds) or at
+ * the deadline (in g_get_monotonic_time() units) and then join the
+ * default priority class. Until then they can be looked up, cancelled
+ * and replaced by tag like the others.
+ */
+void
+gutil_idle_queue_add_delayed(
+    GUtilIdleQueue* queue,
+    guint delay_ms,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc free); /* Since 1.0.82 */
+
+void
+gutil_idle_queue_add_deadline(
+    GUtilIdleQueue* queue,
+    gint64 deadline,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc free); /* Since 1.0.82 */
+
+/*
+ * Can be called from any thread holding a reference to the queue.
+ * The callback gets queued by the main thread, after which it behaves
+ * like the ones added with gutil_idle_queue_add_priority(). The last
+ * reference to the queue has to be released by the main thread.
+ */
+void
+gutil_idle_queue_submit(
+    GUtilIdleQueue* queue,
+    GUTIL_IDLE_QUEUE_PRIORITY priority,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc free); /* Since 1.0.82 */
+
+/*
+ * Statistics are off by default and cost nothing when disabled. The
+ * histograms returned by gutil_idle_queue_get_stats() are owned by the
+ * queue and remain valid until the statistics are disabled or the queue
+ * is freed.
+ */
+void
+gutil_idle_queue_set_stats_enabled(
+    GUtilIdleQueue* queue,
+    gboolean enabled); /* Since 1.0.82 */
+
+gboolean
+gutil_idle_queue_get_stats(
+    GUtilIdleQueue* queue,
+    GUtilIdleQueueStats* stats); /* Since 1.0.82 */
+
+void
+gutil_idle_queue_reset_stats(
+    GUtilIdleQueue* queue); /* Since 1.0.82 */
+
+/*
+ * Tags don't have to be unique, untagged callbacks have zero tag.
+ * gutil_idle_queue_cancel_tag() cancels the oldest callback with the
+ * matching tag.
+ */
 gboolean
 gutil_idle_queue_contains_tag(
     GUtilIdleQueue* queue,
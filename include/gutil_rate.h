@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GUTIL_RATE_H
+#define GUTIL_RATE_H
+
+#include "gutil_history.h"
+
+/*
+ * Event rate meter. Counts events in a fixed number of equal buckets
+ * covering the interval, kept in a circular array. The current (partial)
+ * bucket is included in the window, the oldest one is dropped when a new
+ * one starts. Both gutil_rate_mark() and the queries take constant time
+ * (not counting the buckets expired after a long pause, which are at most
+ * as many as there are buckets).
+ *
+ * The interval is in the units of GUtilHistoryTimeFunc (microseconds by
+ * default) and gets rounded down to a multiple of the bucket count.
+ *
+ * gutil_rate_get() returns the number of events per second, i.e. the
+ * number of events in the window divided by the time it covers. Before
+ * the meter has been running for the whole interval, the time elapsed
+ * since it was created (or cleared) is used instead, but no less than
+ * one bucket.
+ *
+ * GUTIL_RATE_FLAG_ATOMIC allows calling gutil_rate_mark() from multiple
+ * threads simultaneously. Marking the current bucket is lock-free, the
+ * rest is serialized with a mutex. Without this flag, GUtilRate is no
+ * more thread-safe than GUtilIntHistory.
+ *
+ * Since 1.0.82
+ */
+
+G_BEGIN_DECLS
+
+typedef enum gutil_rate_flags {
+    GUTIL_RATE_NO_FLAGS = 0,
+    GUTIL_RATE_FLAG_ATOMIC = 0x1
+} GUTIL_RATE_FLAGS;
+
+GUtilRate*
+gutil_rate_new(
+    gint64 interval,
+    guint buckets);
+
+GUtilRate*
+gutil_rate_new_full(
+    gint64 interval,
+    guint buckets,
+    GUtilHistoryTimeFunc time_fn,
+    GUTIL_RATE_FLAGS flags);
+
+GUtilRate*
+gutil_rate_ref(
+    GUtilRate* rate);
+
+void
+gutil_rate_unref(
+    GUtilRate* rate);
+
+void
+gutil_rate_clear(
+    GUtilRate* rate);
+
+void
+gutil_rate_mark(
+    GUtilRate* rate,
+    guint count);
+
+guint
+gutil_rate_count(
+    GUtilRate* rate);
+
+double
+gutil_rate_get(
+    GUtilRate* rate);
+
+G_END_DECLS
+
+#endif /* GUTIL_RATE_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
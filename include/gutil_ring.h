@@ -48,6 +48,28 @@ G_BEGIN_DECLS
 
 #define GUTIL_RING_UNLIMITED_SIZE (-1)
 
+/*
+ * Iterator walks the contents of the ring from the oldest element to
+ * the newest. The ring must not be modified while being iterated.
+ */
+typedef struct gutil_ring_iter {
+    GUtilRing* ring;
+    gpointer* ptr;
+    gpointer* end;
+    gint segment;
+} GUtilRingIter; /* Since 1.0.82 */
+
+/*
+ * GUTIL_RING_FLAG_OVERWRITE makes gutil_ring_put() evict the oldest
+ * element (invoking the free function for it) when the ring is full,
+ * instead of failing. Has no effect on unlimited rings and doesn't
+ * affect gutil_ring_put_front().
+ */
+typedef enum gutil_ring_flags {
+    GUTIL_RING_NO_FLAGS = 0,
+    GUTIL_RING_FLAG_OVERWRITE = 0x1
+} GUTIL_RING_FLAGS; /* Since 1.0.82 */
+
 GUtilRing*
 gutil_ring_new(void);
 
@@ -62,6 +84,21 @@ gutil_ring_new_full(
     gint max_size,
     GDestroyNotify free_func);
 
+/*
+ * Segmented ring stores its elements in blocks of block_size elements
+ * (a reasonable default is used if block_size is zero or negative).
+ * It grows and shrinks by whole blocks and never moves the elements
+ * around, which avoids latency spikes and memory peaks when the ring
+ * gets really large. The pointer returned by gutil_ring_flatten() for
+ * such a ring may point to a copy of the elements which remains valid
+ * until the ring is modified.
+ */
+GUtilRing*
+gutil_ring_segmented_new(
+    gint block_size,
+    gint max_size,
+    GDestroyNotify free_func); /* Since 1.0.82 */
+
 GUtilRing*
 gutil_ring_ref(
     GUtilRing* ring);
@@ -75,6 +112,15 @@ gutil_ring_set_free_func(
     GUtilRing* ring,
     GDestroyNotify free_func);
 
+GUTIL_RING_FLAGS
+gutil_ring_flags(
+    GUtilRing* ring); /* Since 1.0.82 */
+
+void
+gutil_ring_set_flags(
+    GUtilRing* ring,
+    GUTIL_RING_FLAGS flags); /* Since 1.0.82 */
+
 gint
 gutil_ring_max_size(
     GUtilRing* ring);
@@ -144,6 +190,22 @@ gutil_ring_flatten(
     GUtilRing* ring,
     gint* size);
 
+void
+gutil_ring_foreach(
+    GUtilRing* ring,
+    GFunc func,
+    gpointer user_data); /* Since 1.0.82 */
+
+void
+gutil_ring_iter_init(
+    GUtilRingIter* iter,
+    GUtilRing* ring); /* Since 1.0.82 */
+
+gboolean
+gutil_ring_iter_next(
+    GUtilRingIter* iter,
+    gpointer* data); /* Since 1.0.82 */
+
 G_END_DECLS
 
 #endif /* GUTIL_RING_H */
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef GUTIL_ROLLUP_H
+#define GUTIL_ROLLUP_H
+
+#include "gutil_history.h"
+
+/*
+ * Multi-resolution history for long time windows. Keeps the raw samples
+ * submitted within the last minute, then per-second and per-minute
+ * buckets (count, sum, min and max). The memory is allocated once, and
+ * gutil_rollup_add() takes constant time.
+ *
+ * gutil_rollup_stats() merges whatever covers the requested interval,
+ * using the finest resolution available for each part of it. The oldest
+ * bucket is included in its entirety, i.e. the stats may include samples
+ * up to one bucket width older than requested. Intervals longer than the
+ * per-minute buckets go back in time are truncated.
+ *
+ * If more than max_samples samples are submitted within a minute, the
+ * part of the last minute which they don't cover is taken from the
+ * per-second buckets.
+ *
+ * Just like GUtilIntHistory, it uses microsecond timestamps provided by
+ * GUtilHistoryTimeFunc.
+ *
+ * Since 1.0.82
+ */
+
+G_BEGIN_DECLS
+
+typedef struct gutil_rollup_stats {
+    guint count;
+    gint64 sum;
+    gint64 min;
+    gint64 max;
+} GUtilRollupStats;
+
+GUtilRollup*
+gutil_rollup_new(
+    guint max_samples,
+    guint seconds,
+    guint minutes);
+
+GUtilRollup*
+gutil_rollup_new_full(
+    guint max_samples,
+    guint seconds,
+    guint minutes,
+    GUtilHistoryTimeFunc time_fn);
+
+GUtilRollup*
+gutil_rollup_ref(
+    GUtilRollup* rollup);
+
+void
+gutil_rollup_unref(
+    GUtilRollup* rollup);
+
+void
+gutil_rollup_clear(
+    GUtilRollup* rollup);
+
+void
+gutil_rollup_add(
+    GUtilRollup* rollup,
+    gint64 value);
+
+gboolean
+gutil_rollup_stats(
+    GUtilRollup* rollup,
+    gint64 interval,
+    GUtilRollupStats* stats);
+
+G_END_DECLS
+
+#endif /* GUTIL_ROLLUP_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef GUTIL_TIMERWHEEL_H
+#define GUTIL_TIMERWHEEL_H
+
+#include "gutil_types.h"
+
+/*
+ * GUtilTimerWheel keeps any number of one-shot timers in a hierarchical
+ * timing wheel driven by a single GSource attached to the default main
+ * context. Adding and cancelling a timer takes constant time, and the
+ * source only wakes up the main loop when the next occupied slot of the
+ * wheel is due. That's much cheaper than having a separate GSource per
+ * timer when there are thousands of them.
+ *
+ * Timeouts are in milliseconds and get rounded up to the wheel tick,
+ * which is given to gutil_timer_wheel_new() (zero means 1 ms). Larger
+ * ticks allow more timers to be coalesced into fewer wakeups. Timers
+ * never fire early. Timers expiring at the same tick are invoked in no
+ * particular order.
+ *
+ * Timers can be tagged and cancelled by tag, the same way as callbacks
+ * in GUtilIdleQueue. Tags don't have to be unique, untagged timers have
+ * zero tag. gutil_timer_wheel_cancel_tag() cancels the oldest timer with
+ * the matching tag. The destroy notify is invoked after the timer has
+ * fired or when it gets cancelled, including when the last reference to
+ * the wheel is released.
+ *
+ * GUtilTimerWheel belongs to the thread running the default main context.
+ *
+ * Since 1.0.82
+ */
+
+G_BEGIN_DECLS
+
+typedef gsize GUtilTimerWheelTag;
+
+typedef
+void
+(*GUtilTimerFunc)(
+    gpointer data);
+
+GUtilTimerWheel*
+gutil_timer_wheel_new(
+    guint tick_ms);
+
+GUtilTimerWheel*
+gutil_timer_wheel_ref(
+    GUtilTimerWheel* wheel);
+
+void
+gutil_timer_wheel_unref(
+    GUtilTimerWheel* wheel);
+
+void
+gutil_timer_wheel_add(
+    GUtilTimerWheel* wheel,
+    guint timeout_ms,
+    GUtilTimerWheelTag tag,
+    GUtilTimerFunc run,
+    gpointer data,
+    GFreeFunc free);
+
+guint
+gutil_timer_wheel_count(
+    GUtilTimerWheel* wheel);
+
+gboolean
+gutil_timer_wheel_contains_tag(
+    GUtilTimerWheel* wheel,
+    GUtilTimerWheelTag tag);
+
+gboolean
+gutil_timer_wheel_cancel_tag(
+    GUtilTimerWheel* wheel,
+    GUtilTimerWheelTag tag);
+
+void
+gutil_timer_wheel_cancel_all(
+    GUtilTimerWheel* wheel);
+
+G_END_DECLS
+
+#endif /* GUTIL_TIMERWHEEL_H */
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
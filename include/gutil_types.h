@@ -40,14 +40,22 @@
 G_BEGIN_DECLS
 
 typedef char* GStrV;
+typedef struct gutil_double_history GUtilDoubleHistory; /* Since 1.0.82 */
+typedef struct gutil_event_ring GUtilEventRing; /* Since 1.0.82 */
+typedef struct gutil_ewma GUtilEwma; /* Since 1.0.82 */
+typedef struct gutil_histogram GUtilHistogram; /* Since 1.0.82 */
 typedef struct gutil_idle_pool GUtilIdlePool;
 typedef struct gutil_idle_queue GUtilIdleQueue;
 typedef struct gutil_ints GUtilInts;
 typedef struct gutil_int_array GUtilIntArray;
 typedef struct gutil_int_history GUtilIntHistory;
+typedef struct gutil_int64_history GUtilInt64History; /* Since 1.0.82 */
 typedef struct gutil_inotify_watch GUtilInotifyWatch;
+typedef struct gutil_rate GUtilRate; /* Since 1.0.82 */
 typedef struct gutil_ring GUtilRing;
+typedef struct gutil_rollup GUtilRollup; /* Since 1.0.82 */
 typedef struct gutil_time_notify GUtilTimeNotify;
+typedef struct gutil_timer_wheel GUtilTimerWheel; /* Since 1.0.82 */
 typedef struct gutil_weakref GUtilWeakRef; /* Since 1.0.68 */
 
 typedef struct gutil_data {
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gutil_eventring.h"
+#include "gutil_ring.h"
+#include "gutil_macros.h"
+#include "gutil_log.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+struct gutil_event_ring {
+    gint ref_count;
+    GMutex mutex;
+    GUtilRing* ring;                    /* Producers put data here */
+    GUtilRing* spare;                   /* Swapped with ring on dispatch */
+    gboolean signaled;                  /* Consumer has been woken up */
+    int fd;
+};
+
+typedef struct gutil_event_ring_source {
+    GSource source;
+    GPollFD poll;
+    GUtilEventRing* ring;
+} GUtilEventRingSource;
+
+GUtilEventRing*
+gutil_event_ring_new(
+    gint max_size,
+    GDestroyNotify free_func)
+{
+    const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (fd >= 0) {
+        GUtilEventRing* er = g_slice_new0(GUtilEventRing);
+
+        g_atomic_int_set(&er->ref_count, 1);
+        g_mutex_init(&er->mutex);
+        er->ring = gutil_ring_new_full(0, max_size, free_func);
+        er->spare = gutil_ring_new_full(0, max_size, free_func);
+        er->fd = fd;
+        return er;
+    } else {
+        GERR("eventfd: %s", strerror(errno));
+        return NULL;
+    }
+}
+
+GUtilEventRing*
+gutil_event_ring_ref(
+    GUtilEventRing* er)
+{
+    if (G_LIKELY(er)) {
+        GASSERT(er->ref_count > 0);
+        g_atomic_int_inc(&er->ref_count);
+    }
+    return er;
+}
+
+void
+gutil_event_ring_unref(
+    GUtilEventRing* er)
+{
+    if (G_LIKELY(er)) {
+        GASSERT(er->ref_count > 0);
+        if (g_atomic_int_dec_and_test(&er->ref_count)) {
+            gutil_ring_unref(er->ring);
+            gutil_ring_unref(er->spare);
+            g_mutex_clear(&er->mutex);
+            close(er->fd);
+            gutil_slice_free(er);
+        }
+    }
+}
+
+gint
+gutil_event_ring_size(
+    GUtilEventRing* er)
+{
+    gint size = 0;
+
+    if (G_LIKELY(er)) {
+        g_mutex_lock(&er->mutex);
+        size = gutil_ring_size(er->ring);
+        g_mutex_unlock(&er->mutex);
+    }
+    return size;
+}
+
+gboolean
+gutil_event_ring_put(
+    GUtilEventRing* er,
+    gpointer data)
+{
+    return gutil_event_ring_put_batch(er, &data, 1) == 1;
+}
+
+guint
+gutil_event_ring_put_batch(
+    GUtilEventRing* er,
+    gpointer* data,
+    guint count)
+{
+    guint n = 0;
+
+    if (G_LIKELY(er) && count) {
+        gboolean signal = FALSE;
+
+        g_mutex_lock(&er->mutex);
+        while (n < count && gutil_ring_put(er->ring, data[n])) {
+            n++;
+        }
+        if (n && !er->signaled) {
+            /* Only the first put after the dispatch wakes up the consumer */
+            er->signaled = signal = TRUE;
+        }
+        g_mutex_unlock(&er->mutex);
+
+        if (signal) {
+            const guint64 one = 1;
+
+            /* The counter can't overflow, there's no need to check */
+            if (write(er->fd, &one, sizeof(one)) < 0) {
+                GERR("eventfd write: %s", strerror(errno));
+            }
+        }
+    }
+    return n;
+}
+
+static
+gboolean
+gutil_event_ring_source_prepare(
+    GSource* source,
+    gint* timeout)
+{
+    *timeout = -1;
+    return FALSE;
+}
+
+static
+gboolean
+gutil_event_ring_source_check(
+    GSource* source)
+{
+    GUtilEventRingSource* src = (GUtilEventRingSource*)source;
+
+    return (src->poll.revents & G_IO_IN) != 0;
+}
+
+static
+gboolean
+gutil_event_ring_source_dispatch(
+    GSource* source,
+    GSourceFunc callback,
+    gpointer user_data)
+{
+    GUtilEventRingSource* src = (GUtilEventRingSource*)source;
+    GUtilEventRing* er = src->ring;
+    GUtilRing* batch;
+    guint64 value;
+    gpointer* data;
+    gint n;
+
+    /* Reset the counter before taking the data */
+    if (read(er->fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        GERR("eventfd read: %s", strerror(errno));
+    }
+
+    /* Take everything that's been accumulated so far */
+    g_mutex_lock(&er->mutex);
+    batch = er->ring;
+    er->ring = er->spare;
+    er->spare = batch;
+    er->signaled = FALSE;
+    g_mutex_unlock(&er->mutex);
+
+    /* The batch belongs to us until the next dispatch */
+    data = gutil_ring_flatten(batch, &n);
+    if (n > 0) {
+        GUtilEventRingFunc func = (GUtilEventRingFunc)callback;
+
+        gutil_event_ring_ref(er);
+        if (func) {
+            func(er, data, n, user_data);
+        }
+        gutil_ring_clear(batch);
+        gutil_event_ring_unref(er);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static
+void
+gutil_event_ring_source_finalize(
+    GSource* source)
+{
+    GUtilEventRingSource* src = (GUtilEventRingSource*)source;
+
+    gutil_event_ring_unref(src->ring);
+}
+
+GSource*
+gutil_event_ring_source_new(
+    GUtilEventRing* er,
+    GUtilEventRingFunc func,
+    gpointer user_data,
+    GDestroyNotify destroy)
+{
+    if (G_LIKELY(er)) {
+        static GSourceFuncs gutil_event_ring_source_funcs = {
+            gutil_event_ring_source_prepare,
+            gutil_event_ring_source_check,
+            gutil_event_ring_source_dispatch,
+            gutil_event_ring_source_finalize
+        };
+        GSource* source = g_source_new(&gutil_event_ring_source_funcs,
+            sizeof(GUtilEventRingSource));
+        GUtilEventRingSource* src = (GUtilEventRingSource*)source;
+
+        src->ring = gutil_event_ring_ref(er);
+        src->poll.fd = er->fd;
+        src->poll.events = G_IO_IN | G_IO_ERR;
+        g_source_add_poll(source, &src->poll);
+        g_source_set_callback(source, (GSourceFunc)func, user_data, destroy);
+        return source;
+    }
+    return NULL;
+}
+
+guint
+gutil_event_ring_add_handler(
+    GUtilEventRing* er,
+    GUtilEventRingFunc func,
+    gpointer user_data)
+{
+    GSource* source = gutil_event_ring_source_new(er, func, user_data, NULL);
+
+    if (source) {
+        GMainContext* context = g_main_context_get_thread_default();
+        const guint id = g_source_attach(source, context ? context :
+            g_main_context_default());
+
+        g_source_unref(source);
+        return id;
+    }
+    return 0;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gutil_ewma.h"
+#include "gutil_macros.h"
+#include "gutil_log.h"
+
+#include <math.h>
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+#define GUTIL_EWMA_DEFAULT_TIME_FUNC g_get_monotonic_time
+
+struct gutil_ewma {
+    gint ref_count;
+    gboolean empty;
+    GUtilHistoryTimeFunc time;
+    double tau;                         /* Time constant */
+    gint64 last_time;                   /* Time of the last sample */
+    double alpha;                       /* Weight of the last sample */
+    double base_mean;                   /* Before the last sample */
+    double base_var;                    /* Before the last sample */
+    double mean;
+    double var;
+};
+
+static
+void
+gutil_ewma_update(
+    GUtilEwma* e,
+    double value)
+{
+    /* Incremental formulas from Tony Finch's "Incremental calculation
+     * of weighted mean and variance" */
+    const double diff = value - e->base_mean;
+    const double incr = e->alpha * diff;
+
+    e->mean = e->base_mean + incr;
+    e->var = (1 - e->alpha) * (e->base_var + diff * incr);
+}
+
+GUtilEwma*
+gutil_ewma_new(
+    gint64 time_constant)
+{
+    return gutil_ewma_new_full(time_constant, NULL);
+}
+
+GUtilEwma*
+gutil_ewma_new_full(
+    gint64 time_constant,
+    GUtilHistoryTimeFunc fn)
+{
+    if (time_constant > 0) {
+        GUtilEwma* e = g_slice_new0(GUtilEwma);
+
+        g_atomic_int_set(&e->ref_count, 1);
+        e->empty = TRUE;
+        e->tau = (double)time_constant;
+        e->time = fn ? fn : GUTIL_EWMA_DEFAULT_TIME_FUNC;
+        return e;
+    }
+    return NULL;
+}
+
+GUtilEwma*
+gutil_ewma_ref(
+    GUtilEwma* e)
+{
+    if (G_LIKELY(e)) {
+        GASSERT(e->ref_count > 0);
+        g_atomic_int_inc(&e->ref_count);
+    }
+    return e;
+}
+
+void
+gutil_ewma_unref(
+    GUtilEwma* e)
+{
+    if (G_LIKELY(e)) {
+        GASSERT(e->ref_count > 0);
+        if (g_atomic_int_dec_and_test(&e->ref_count)) {
+            gutil_slice_free(e);
+        }
+    }
+}
+
+void
+gutil_ewma_clear(
+    GUtilEwma* e)
+{
+    if (G_LIKELY(e)) {
+        e->empty = TRUE;
+        e->mean = e->var = 0;
+    }
+}
+
+double
+gutil_ewma_add(
+    GUtilEwma* e,
+    double value)
+{
+    if (G_LIKELY(e)) {
+        const gint64 now = e->time();
+
+        if (e->empty) {
+            /* The first sample takes it all */
+            e->empty = FALSE;
+            e->last_time = now;
+            e->alpha = 1;
+            e->base_mean = e->base_var = 0;
+        } else if (now > e->last_time) {
+            /* 1 - exp(-x) loses precision for small x, expm1 doesn't */
+            e->alpha = -expm1((e->last_time - now) / e->tau);
+            e->last_time = now;
+            e->base_mean = e->mean;
+            e->base_var = e->var;
+        }
+        /* Otherwise the last sample gets replaced */
+        gutil_ewma_update(e, value);
+        return e->mean;
+    }
+    return 0;
+}
+
+double
+gutil_ewma_mean(
+    GUtilEwma* e,
+    double default_value)
+{
+    return (G_LIKELY(e) && !e->empty) ? e->mean : default_value;
+}
+
+double
+gutil_ewma_variance(
+    GUtilEwma* e,
+    double default_value)
+{
+    return (G_LIKELY(e) && !e->empty) ? e->var : default_value;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
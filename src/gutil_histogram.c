@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gutil_histogram.h"
+#include "gutil_datapack.h"
+#include "gutil_log.h"
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+struct gutil_histogram {
+    gint ref_count;
+    guint bits;                         /* Precision bits */
+    guint nbuckets;
+    guint64 max_value;                  /* Highest trackable value */
+    guint64 count;
+    guint64 sum;                        /* Wraps around on overflow */
+    guint64 min;
+    guint64 max;
+    guint64 bucket[1];
+};
+
+static inline
+guint
+gutil_histogram_msb(
+    guint64 value)
+{
+    /* Index of the most significant bit, value must be non-zero */
+#if __GNUC__ >= 4
+    return 63 - __builtin_clzll(value);
+#else
+    guint n = 0;
+
+    while (value >>= 1) {
+        n++;
+    }
+    return n;
+#endif
+}
+
+static
+guint
+gutil_histogram_index(
+    guint bits,
+    guint64 value)
+{
+    const guint64 linear = G_GUINT64_CONSTANT(1) << bits;
+
+    if (value < linear) {
+        /* Small values are stored exactly */
+        return (guint) value;
+    } else {
+        /* Top bits + 1 bits select the bucket within the power of 2 */
+        const guint shift = gutil_histogram_msb(value) - bits;
+
+        return ((shift + 1) << bits) + (guint)((value >> shift) - linear);
+    }
+}
+
+static
+guint64
+gutil_histogram_highest(
+    guint bits,
+    guint index)
+{
+    /* The highest value which ends up in this bucket */
+    if (index < (1u << bits)) {
+        return index;
+    } else {
+        const guint shift = (index >> bits) - 1;
+        const guint64 sub = index & ((1u << bits) - 1);
+        const guint64 low = ((G_GUINT64_CONSTANT(1) << bits) + sub) << shift;
+
+        return low + ((G_GUINT64_CONSTANT(1) << shift) - 1);
+    }
+}
+
+static
+void
+gutil_histogram_reset(
+    GUtilHistogram* h)
+{
+    h->count = h->sum = h->min = h->max = 0;
+    memset(h->bucket, 0, sizeof(h->bucket[0]) * h->nbuckets);
+}
+
+GUtilHistogram*
+gutil_histogram_new(
+    guint64 max_value,
+    guint bits)
+{
+    if (bits > 0 && bits <= GUTIL_HISTOGRAM_MAX_PRECISION_BITS) {
+        const guint n = gutil_histogram_index(bits, max_value) + 1;
+        GUtilHistogram* h = g_malloc0(sizeof(GUtilHistogram) +
+            (n - 1) * sizeof(h->bucket[0]));
+
+        g_atomic_int_set(&h->ref_count, 1);
+        h->bits = bits;
+        h->nbuckets = n;
+        h->max_value = max_value;
+        return h;
+    }
+    return NULL;
+}
+
+GUtilHistogram*
+gutil_histogram_ref(
+    GUtilHistogram* h)
+{
+    if (G_LIKELY(h)) {
+        GASSERT(h->ref_count > 0);
+        g_atomic_int_inc(&h->ref_count);
+    }
+    return h;
+}
+
+void
+gutil_histogram_unref(
+    GUtilHistogram* h)
+{
+    if (G_LIKELY(h)) {
+        GASSERT(h->ref_count > 0);
+        if (g_atomic_int_dec_and_test(&h->ref_count)) {
+            g_free(h);
+        }
+    }
+}
+
+void
+gutil_histogram_clear(
+    GUtilHistogram* h)
+{
+    if (G_LIKELY(h)) {
+        gutil_histogram_reset(h);
+    }
+}
+
+void
+gutil_histogram_add(
+    GUtilHistogram* h,
+    guint64 value)
+{
+    if (G_LIKELY(h)) {
+        h->bucket[gutil_histogram_index(h->bits,
+            MIN(value, h->max_value))]++;
+        if (h->count++) {
+            if (h->min > value) {
+                h->min = value;
+            }
+            if (h->max < value) {
+                h->max = value;
+            }
+        } else {
+            h->min = h->max = value;
+        }
+        h->sum += value;
+    }
+}
+
+gboolean
+gutil_histogram_merge(
+    GUtilHistogram* h,
+    const GUtilHistogram* other)
+{
+    if (G_LIKELY(h) && G_LIKELY(other) && h->bits == other->bits &&
+        h->max_value == other->max_value) {
+        if (other->count) {
+            guint i;
+
+            for (i = 0; i < h->nbuckets; i++) {
+                h->bucket[i] += other->bucket[i];
+            }
+            if (h->count) {
+                h->min = MIN(h->min, other->min);
+                h->max = MAX(h->max, other->max);
+            } else {
+                h->min = other->min;
+                h->max = other->max;
+            }
+            h->count += other->count;
+            h->sum += other->sum;
+        }
+        return TRUE;
+    }
+    return FALSE;
+}
+
+guint64
+gutil_histogram_count(
+    const GUtilHistogram* h)
+{
+    return G_LIKELY(h) ? h->count : 0;
+}
+
+guint64
+gutil_histogram_min(
+    const GUtilHistogram* h)
+{
+    return G_LIKELY(h) ? h->min : 0;
+}
+
+guint64
+gutil_histogram_max(
+    const GUtilHistogram* h)
+{
+    return G_LIKELY(h) ? h->max : 0;
+}
+
+double
+gutil_histogram_mean(
+    const GUtilHistogram* h)
+{
+    return (G_LIKELY(h) && h->count) ? ((double)h->sum / h->count) : 0;
+}
+
+guint64
+gutil_histogram_percentile(
+    const GUtilHistogram* h,
+    double percent)
+{
+    if (G_LIKELY(h) && h->count) {
+        /* Nearest rank */
+        const double exact = MIN(MAX(percent, 0), 100) * h->count / 100;
+        guint64 rank = (guint64) exact;
+        guint64 n = 0;
+        guint i;
+
+        if (rank < exact) {
+            rank++;
+        }
+        rank = MAX(rank, 1);
+        for (i = 0; i < h->nbuckets; i++) {
+            n += h->bucket[i];
+            if (n >= rank) {
+                /* The last bucket also holds values above max_value */
+                const guint64 value = (i + 1 < h->nbuckets) ?
+                    gutil_histogram_highest(h->bits, i) : h->max;
+
+                return MIN(MAX(value, h->min), h->max);
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * Serialized format (all numbers are unsigned MBNs):
+ *
+ *   precision bits, max value, count, sum, min, max
+ *
+ * followed by (gap, count) pairs for each non-empty bucket, where gap
+ * is the number of empty buckets preceding it.
+ */
+
+#define GUTIL_HISTOGRAM_HEADER_SIZE (6)
+
+/*
+ * The header comes from untrusted input and may describe a histogram
+ * which takes megabytes to allocate. Refuse to decode anything larger
+ * than 1M buckets (8MB), which is still enough for the full 64-bit range
+ * at 14 bits of precision.
+ */
+#define GUTIL_HISTOGRAM_DECODE_MAX_BUCKETS (0x100000)
+
+static
+gsize
+gutil_histogram_encode_buckets(
+    const GUtilHistogram* h,
+    guint8* buf)
+{
+    /* Returns the size, without writing anything if buf is NULL */
+    guint i, gap = 0;
+    gsize size = 0;
+
+    for (i = 0; i < h->nbuckets; i++) {
+        const guint64 count = h->bucket[i];
+
+        if (count) {
+            if (buf) {
+                size += gutil_unsigned_mbn_encode(buf + size, gap);
+                size += gutil_unsigned_mbn_encode(buf + size, count);
+            } else {
+                size += gutil_unsigned_mbn_size(gap) +
+                    gutil_unsigned_mbn_size(count);
+            }
+            gap = 0;
+        } else {
+            gap++;
+        }
+    }
+    return size;
+}
+
+GBytes*
+gutil_histogram_encode(
+    const GUtilHistogram* h)
+{
+    if (G_LIKELY(h)) {
+        guint64 header[GUTIL_HISTOGRAM_HEADER_SIZE];
+        gsize size = gutil_histogram_encode_buckets(h, NULL);
+        guint8* buf;
+        guint i;
+
+        header[0] = h->bits;
+        header[1] = h->max_value;
+        header[2] = h->count;
+        header[3] = h->sum;
+        header[4] = h->min;
+        header[5] = h->max;
+        for (i = 0; i < G_N_ELEMENTS(header); i++) {
+            size += gutil_unsigned_mbn_size(header[i]);
+        }
+
+        buf = g_malloc(size);
+        size = 0;
+        for (i = 0; i < G_N_ELEMENTS(header); i++) {
+            size += gutil_unsigned_mbn_encode(buf + size, header[i]);
+        }
+        size += gutil_histogram_encode_buckets(h, buf + size);
+        return g_bytes_new_take(buf, size);
+    }
+    return NULL;
+}
+
+GUtilHistogram*
+gutil_histogram_decode(
+    const GUtilData* data)
+{
+    if (G_LIKELY(data)) {
+        guint64 header[GUTIL_HISTOGRAM_HEADER_SIZE];
+        GUtilRange in;
+        guint i;
+
+        in.ptr = data->bytes;
+        in.end = in.ptr + data->size;
+        for (i = 0; i < G_N_ELEMENTS(header); i++) {
+            if (!gutil_unsigned_mbn_decode(&in, header + i)) {
+                return NULL;
+            }
+        }
+
+        if (header[0] > 0 && header[0] <= GUTIL_HISTOGRAM_MAX_PRECISION_BITS &&
+            gutil_histogram_index((guint) header[0], header[1]) <
+            GUTIL_HISTOGRAM_DECODE_MAX_BUCKETS) {
+            GUtilHistogram* h = gutil_histogram_new(header[1],
+                (guint) header[0]);
+
+            if (h) {
+                gboolean ok = TRUE;
+                guint64 total = 0;
+                guint64 index = 0;
+
+                while (ok && in.ptr < in.end) {
+                    guint64 gap, count;
+
+                    if (gutil_unsigned_mbn_decode(&in, &gap) &&
+                        gutil_unsigned_mbn_decode(&in, &count) && count &&
+                        gap < h->nbuckets - index) {
+                        index += gap;
+                        h->bucket[index++] = count;
+                        total += count;
+                    } else {
+                        ok = FALSE;
+                    }
+                }
+
+                /* The counts must add up */
+                if (ok && total == header[2] &&
+                    (!total || (header[4] <= header[5]))) {
+                    h->count = header[2];
+                    h->sum = header[3];
+                    h->min = header[4];
+                    h->max = header[5];
+                    return h;
+                }
+                gutil_histogram_unref(h);
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
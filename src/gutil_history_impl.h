@@ -0,0 +1,828 @@
+/*
+ * Copyright (C) 2017-2023 Slava Monich <slava@monich.com>
+ * Copyright (C) 2017 Jolla Ltd.
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * History implementation template, included by gutil_history.c once
+ * per value type. The includer defines:
+ *
+ *   GUTIL_HISTORY_STRUCT      struct tag and function name prefix
+ *   GUTIL_HISTORY_TYPE        public typedef for the struct
+ *   GUTIL_HISTORY_VALUE       type of the values
+ *   GUTIL_HISTORY_AREA        type of the integral (area under the curve)
+ *   GUTIL_HISTORY_AREA_EXACT  1 if GUTIL_HISTORY_AREA is an integer type
+ *
+ * and optionally:
+ *
+ *   GUTIL_HISTORY_VALUE_VALID(v)  FALSE for values which can't be stored
+ *
+ * All of these are undefined at the end of this file.
+ */
+
+#define GUTIL_HISTORY_PASTE_(a,b) a##_##b
+#define GUTIL_HISTORY_PASTE(a,b) GUTIL_HISTORY_PASTE_(a,b)
+#define GUTIL_HISTORY_FN(x) GUTIL_HISTORY_PASTE(GUTIL_HISTORY_STRUCT,x)
+
+/*
+ * Timestamps and values are stored in separate arrays (rather than an
+ * array of structures) which avoids padding and lets the loops over
+ * one of them touch only that array.
+ */
+struct GUTIL_HISTORY_STRUCT {
+    gint ref_count;
+    GUtilHistoryTimeFunc time;
+    gint64 max_interval;
+    int first;                          /* Oldest position (inclusive) */
+    int last;                           /* Latest position (inclusive) */
+    int max_size;                       /* Number of entries */
+    gint64 deadline;                    /* When the first entry expires */
+    GUTIL_HISTORY_AREA area;            /* Integral from first to last */
+#if !GUTIL_HISTORY_AREA_EXACT
+    int area_updates;                   /* Since the last recalculation */
+#endif
+    GUtilHistoryNode* node;             /* Order statistics (optional) */
+    int root;                           /* Root of the tree */
+    guint32 seed;                       /* For node priorities */
+    GUtilHistoryDeque* minmax;          /* Sliding min and max (optional) */
+    gint64* timestamp;                  /* max_size timestamps */
+    GUTIL_HISTORY_VALUE* value;         /* max_size values */
+};
+
+static inline
+int
+GUTIL_HISTORY_FN(next)(
+    GUTIL_HISTORY_TYPE* h,
+    int pos)
+{
+    return (pos + 1) % h->max_size;
+}
+
+static inline
+int
+GUTIL_HISTORY_FN(prev)(
+    GUTIL_HISTORY_TYPE* h,
+    int pos)
+{
+    return (pos + h->max_size - 1) % h->max_size;
+}
+
+/*==========================================================================*
+ * Order statistics
+ *==========================================================================*/
+
+static inline
+int
+GUTIL_HISTORY_FN(tree_size)(
+    GUTIL_HISTORY_TYPE* h,
+    int t)
+{
+    return (t < 0) ? 0 : h->node[t].size;
+}
+
+static inline
+void
+GUTIL_HISTORY_FN(tree_update)(
+    GUTIL_HISTORY_TYPE* h,
+    int t)
+{
+    GUtilHistoryNode* node = h->node + t;
+
+    node->size = GUTIL_HISTORY_FN(tree_size)(h, node->left) +
+        GUTIL_HISTORY_FN(tree_size)(h, node->right) + 1;
+}
+
+static inline
+gboolean
+GUTIL_HISTORY_FN(tree_less)(
+    GUTIL_HISTORY_TYPE* h,
+    int a,
+    int b)
+{
+    /* Entries are ordered by value, then by position */
+    const GUTIL_HISTORY_VALUE va = h->value[a];
+    const GUTIL_HISTORY_VALUE vb = h->value[b];
+
+    return va < vb || (va == vb && a < b);
+}
+
+static
+int
+GUTIL_HISTORY_FN(tree_merge)(
+    GUTIL_HISTORY_TYPE* h,
+    int l,
+    int r)
+{
+    /* Everything in l is less than anything in r */
+    if (l < 0) {
+        return r;
+    } else if (r < 0) {
+        return l;
+    } else if (h->node[l].prio > h->node[r].prio) {
+        h->node[l].right = GUTIL_HISTORY_FN(tree_merge)(h,
+            h->node[l].right, r);
+        GUTIL_HISTORY_FN(tree_update)(h, l);
+        return l;
+    } else {
+        h->node[r].left = GUTIL_HISTORY_FN(tree_merge)(h,
+            l, h->node[r].left);
+        GUTIL_HISTORY_FN(tree_update)(h, r);
+        return r;
+    }
+}
+
+static
+void
+GUTIL_HISTORY_FN(tree_split)(
+    GUTIL_HISTORY_TYPE* h,
+    int t,
+    int pos,
+    int* l,
+    int* r)
+{
+    /* Splits the tree into nodes less than pos and the rest */
+    if (t < 0) {
+        *l = *r = -1;
+    } else if (GUTIL_HISTORY_FN(tree_less)(h, t, pos)) {
+        GUTIL_HISTORY_FN(tree_split)(h, h->node[t].right, pos,
+            &h->node[t].right, r);
+        GUTIL_HISTORY_FN(tree_update)(h, t);
+        *l = t;
+    } else {
+        GUTIL_HISTORY_FN(tree_split)(h, h->node[t].left, pos,
+            l, &h->node[t].left);
+        GUTIL_HISTORY_FN(tree_update)(h, t);
+        *r = t;
+    }
+}
+
+static
+int
+GUTIL_HISTORY_FN(tree_erase)(
+    GUTIL_HISTORY_TYPE* h,
+    int t,
+    int pos)
+{
+    GUtilHistoryNode* node = h->node + t;
+
+    GASSERT(t >= 0);
+    if (t == pos) {
+        return GUTIL_HISTORY_FN(tree_merge)(h, node->left, node->right);
+    } else if (GUTIL_HISTORY_FN(tree_less)(h, pos, t)) {
+        node->left = GUTIL_HISTORY_FN(tree_erase)(h, node->left, pos);
+    } else {
+        node->right = GUTIL_HISTORY_FN(tree_erase)(h, node->right, pos);
+    }
+    node->size--;
+    return t;
+}
+
+static
+void
+GUTIL_HISTORY_FN(tree_insert)(
+    GUTIL_HISTORY_TYPE* h,
+    int pos)
+{
+    if (h->node) {
+        GUtilHistoryNode* node = h->node + pos;
+        int l, r;
+
+        /* xorshift32 is random enough for this purpose */
+        h->seed ^= h->seed << 13;
+        h->seed ^= h->seed >> 17;
+        h->seed ^= h->seed << 5;
+        node->prio = h->seed;
+        node->left = node->right = -1;
+        node->size = 1;
+        GUTIL_HISTORY_FN(tree_split)(h, h->root, pos, &l, &r);
+        h->root = GUTIL_HISTORY_FN(tree_merge)(h,
+            GUTIL_HISTORY_FN(tree_merge)(h, l, pos), r);
+    }
+}
+
+static
+void
+GUTIL_HISTORY_FN(tree_remove)(
+    GUTIL_HISTORY_TYPE* h,
+    int pos)
+{
+    if (h->node) {
+        h->root = GUTIL_HISTORY_FN(tree_erase)(h, h->root, pos);
+    }
+}
+
+static
+GUTIL_HISTORY_VALUE
+GUTIL_HISTORY_FN(tree_at)(
+    GUTIL_HISTORY_TYPE* h,
+    int k)
+{
+    /* Returns k-th smallest value, the caller checks the range */
+    int t = h->root;
+
+    for (;;) {
+        const GUtilHistoryNode* node = h->node + t;
+        const int left = GUTIL_HISTORY_FN(tree_size)(h, node->left);
+
+        if (k < left) {
+            t = node->left;
+        } else if (k > left) {
+            k -= left + 1;
+            t = node->right;
+        } else {
+            return h->value[t];
+        }
+    }
+}
+
+/*==========================================================================*
+ * Min/max
+ *==========================================================================*/
+
+static
+void
+GUTIL_HISTORY_FN(deque_push)(
+    GUTIL_HISTORY_TYPE* h,
+    GUtilHistoryDeque* d,
+    int pos)
+{
+    const GUTIL_HISTORY_VALUE value = h->value[pos];
+
+    /* Drop the values which can no longer be the min (or max) */
+    while (d->count > 0) {
+        const int back = d->slot[(d->start + d->count - 1) % h->max_size];
+        const GUTIL_HISTORY_VALUE v = h->value[back];
+
+        if (d->max ? (v <= value) : (v >= value)) {
+            d->count--;
+        } else {
+            break;
+        }
+    }
+    d->slot[(d->start + d->count) % h->max_size] = pos;
+    d->count++;
+}
+
+static
+void
+GUTIL_HISTORY_FN(deque_build)(
+    GUTIL_HISTORY_TYPE* h,
+    GUtilHistoryDeque* d)
+{
+    int pos = h->first;
+
+    d->start = d->count = 0;
+    d->valid = TRUE;
+    GUTIL_HISTORY_FN(deque_push)(h, d, pos);
+    while (pos != h->last) {
+        pos = GUTIL_HISTORY_FN(next)(h, pos);
+        GUTIL_HISTORY_FN(deque_push)(h, d, pos);
+    }
+}
+
+static
+void
+GUTIL_HISTORY_FN(minmax_push)(
+    GUTIL_HISTORY_TYPE* h,
+    int pos)
+{
+    if (h->minmax) {
+        int i;
+
+        for (i = 0; i < 2; i++) {
+            GUtilHistoryDeque* d = h->minmax + i;
+
+            if (d->valid) {
+                GUTIL_HISTORY_FN(deque_push)(h, d, pos);
+            }
+        }
+    }
+}
+
+static
+void
+GUTIL_HISTORY_FN(minmax_drop)(
+    GUTIL_HISTORY_TYPE* h,
+    int pos)
+{
+    if (h->minmax) {
+        int i;
+
+        for (i = 0; i < 2; i++) {
+            GUtilHistoryDeque* d = h->minmax + i;
+
+            if (d->valid && d->count > 0 && d->slot[d->start] == pos) {
+                d->start = (d->start + 1) % h->max_size;
+                d->count--;
+            }
+        }
+    }
+}
+
+static
+void
+GUTIL_HISTORY_FN(minmax_replace)(
+    GUTIL_HISTORY_TYPE* h,
+    GUTIL_HISTORY_VALUE old_value)
+{
+    /* The last value has changed */
+    if (h->minmax) {
+        const GUTIL_HISTORY_VALUE value = h->value[h->last];
+        int i;
+
+        for (i = 0; i < 2; i++) {
+            GUtilHistoryDeque* d = h->minmax + i;
+
+            if (d->valid) {
+                if (d->max ? (value >= old_value) : (value <= old_value)) {
+                    /* The last entry is always at the back */
+                    d->count--;
+                    GUTIL_HISTORY_FN(deque_push)(h, d, h->last);
+                } else {
+                    /* The values it has pushed out may be needed again */
+                    d->valid = FALSE;
+                }
+            }
+        }
+    }
+}
+
+static
+void
+GUTIL_HISTORY_FN(minmax_reset)(
+    GUTIL_HISTORY_TYPE* h)
+{
+    if (h->minmax) {
+        int i;
+
+        for (i = 0; i < 2; i++) {
+            GUtilHistoryDeque* d = h->minmax + i;
+
+            d->start = d->count = 0;
+            d->valid = TRUE;
+        }
+    }
+}
+
+/*==========================================================================*
+ * Implementation
+ *==========================================================================*/
+
+/*
+ * The area under the first..last polyline is maintained incrementally,
+ * segment by segment, so that the median doesn't have to walk the
+ * entire history. The time interval is simply the difference between
+ * the timestamps of the last and the first entries.
+ */
+static inline
+GUTIL_HISTORY_AREA
+GUTIL_HISTORY_FN(segment)(
+    GUTIL_HISTORY_TYPE* h,
+    int i,
+    int j)
+{
+    /* The sum of two values may not fit into GUTIL_HISTORY_VALUE */
+    return (h->timestamp[j] - h->timestamp[i]) *
+        ((GUTIL_HISTORY_AREA)h->value[i] + h->value[j]) / 2;
+}
+
+#if !GUTIL_HISTORY_AREA_EXACT
+static
+GUTIL_HISTORY_AREA
+GUTIL_HISTORY_FN(area_range)(
+    GUTIL_HISTORY_TYPE* h,
+    int i,
+    int j)
+{
+    /* Contiguous range i..j, no wraparound, a straight loop */
+    GUTIL_HISTORY_AREA area = 0;
+
+    for (; i < j; i++) {
+        area += GUTIL_HISTORY_FN(segment)(h, i, i + 1);
+    }
+    return area;
+}
+#endif
+
+static
+void
+GUTIL_HISTORY_FN(area_updated)(
+    GUTIL_HISTORY_TYPE* h)
+{
+#if !GUTIL_HISTORY_AREA_EXACT
+    /*
+     * Floating point rounding errors accumulate as segments are added
+     * and subtracted. Every max_size subtractions the area is calculated
+     * from scratch, which keeps the amortized cost O(1).
+     */
+    if (++(h->area_updates) >= h->max_size) {
+        const int end = h->max_size - 1;
+
+        h->area_updates = 0;
+        if (h->first <= h->last) {
+            h->area = GUTIL_HISTORY_FN(area_range)(h, h->first, h->last);
+        } else {
+            h->area = GUTIL_HISTORY_FN(area_range)(h, h->first, end) +
+                GUTIL_HISTORY_FN(segment)(h, end, 0) +
+                GUTIL_HISTORY_FN(area_range)(h, 0, h->last);
+        }
+    }
+#endif
+}
+
+static
+void
+GUTIL_HISTORY_FN(drop_first)(
+    GUTIL_HISTORY_TYPE* h)
+{
+    /* The caller has checked that first != last */
+    const int next = GUTIL_HISTORY_FN(next)(h, h->first);
+
+    h->area -= GUTIL_HISTORY_FN(segment)(h, h->first, next);
+    GUTIL_HISTORY_FN(tree_remove)(h, h->first);
+    GUTIL_HISTORY_FN(minmax_drop)(h, h->first);
+    h->first = next;
+    GUTIL_HISTORY_FN(area_updated)(h);
+}
+
+static
+void
+GUTIL_HISTORY_FN(update_deadline)(
+    GUTIL_HISTORY_TYPE* h)
+{
+    const gint64 t = h->timestamp[h->first];
+
+    /* Until then, there's no need to look at the timestamps */
+    h->deadline = (t < G_MAXINT64 - h->max_interval) ?
+        (t + h->max_interval) : G_MAXINT64;
+}
+
+static
+void
+GUTIL_HISTORY_FN(reset)(
+    GUTIL_HISTORY_TYPE* h)
+{
+    h->last = h->first = -1;
+    h->deadline = G_MININT64;
+    h->area = 0;
+#if !GUTIL_HISTORY_AREA_EXACT
+    h->area_updates = 0;
+#endif
+    h->root = -1;
+    GUTIL_HISTORY_FN(minmax_reset)(h);
+}
+
+GUTIL_HISTORY_TYPE*
+GUTIL_HISTORY_FN(new)(
+    int max_size,
+    gint64 max_interval)
+{
+    return GUTIL_HISTORY_FN(new_full)(max_size, max_interval, NULL);
+}
+
+GUTIL_HISTORY_TYPE*
+GUTIL_HISTORY_FN(new_full)(
+    int max_size,
+    gint64 max_interval,
+    GUtilHistoryTimeFunc fn)
+{
+    if (max_size > 0 && max_interval > 0) {
+        /*
+         * We don't allow to dynamically change the maximum history size
+         * so we can allocate the whole thing from a single memory block.
+         */
+        GUTIL_HISTORY_TYPE* h = g_malloc0(sizeof(GUTIL_HISTORY_TYPE) +
+            max_size * (sizeof(gint64) + sizeof(GUTIL_HISTORY_VALUE)));
+
+        g_atomic_int_set(&h->ref_count, 1);
+        h->timestamp = (gint64*)(h + 1);
+        h->value = (GUTIL_HISTORY_VALUE*)(h->timestamp + max_size);
+        h->max_size = max_size;
+        h->max_interval = max_interval;
+        h->first = h->last = -1;
+        h->root = -1;
+        h->seed = 1;
+        h->time = fn ? fn : GUTIL_HISTORY_DEFAULT_TIME_FUNC;
+        return h;
+    }
+    return NULL;
+}
+
+GUTIL_HISTORY_TYPE*
+GUTIL_HISTORY_FN(ref)(
+    GUTIL_HISTORY_TYPE* h)
+{
+    if (G_LIKELY(h)) {
+        GASSERT(h->ref_count > 0);
+        g_atomic_int_inc(&h->ref_count);
+    }
+    return h;
+}
+
+void
+GUTIL_HISTORY_FN(unref)(
+    GUTIL_HISTORY_TYPE* h)
+{
+    if (G_LIKELY(h)) {
+        GASSERT(h->ref_count > 0);
+        if (g_atomic_int_dec_and_test(&h->ref_count)) {
+            g_free(h->node);
+            g_free(h->minmax);
+            g_free(h);
+        }
+    }
+}
+
+static
+gboolean
+GUTIL_HISTORY_FN(flush)(
+    GUTIL_HISTORY_TYPE* h,
+    const gint64 now)
+{
+    const gint64 cutoff = now - h->max_interval;
+
+    if (now <= h->deadline) {
+        /* Nothing has expired yet */
+        return TRUE;
+    } else if (h->timestamp[h->last] >= cutoff) {
+        /* At least the last entry is valid */
+        while (h->timestamp[h->first] < cutoff) {
+            GUTIL_HISTORY_FN(drop_first)(h);
+        }
+        GUTIL_HISTORY_FN(update_deadline)(h);
+        return TRUE;
+    } else {
+        /* The last entry has expired */
+        GUTIL_HISTORY_FN(reset)(h);
+        return FALSE;
+    }
+}
+
+guint
+GUTIL_HISTORY_FN(size)(
+    GUTIL_HISTORY_TYPE* h)
+{
+    if (G_LIKELY(h) && h->last >= 0) {
+        if (GUTIL_HISTORY_FN(flush)(h, h->time())) {
+            if (h->first > h->last) {
+                return (h->max_size + h->last - h->first + 1);
+            } else {
+                GASSERT(h->last > h->first);
+                return (h->last - h->first + 1);
+            }
+        }
+    }
+    return 0;
+}
+
+gint64
+GUTIL_HISTORY_FN(interval)(
+    GUTIL_HISTORY_TYPE* h)
+{
+    if (G_LIKELY(h) && h->last >= 0) {
+	const gint64 now = h->time();
+
+        if (GUTIL_HISTORY_FN(flush)(h, now)) {
+            return now - h->timestamp[h->first];
+        }
+    }
+    return 0;
+}
+
+void
+GUTIL_HISTORY_FN(clear)(
+    GUTIL_HISTORY_TYPE* h)
+{
+    if (G_LIKELY(h)) {
+        GUTIL_HISTORY_FN(reset)(h);
+    }
+}
+
+
+static
+GUTIL_HISTORY_VALUE
+GUTIL_HISTORY_FN(median_at)(
+    GUTIL_HISTORY_TYPE* h,
+    const gint64 now)
+{
+    /* The caller has already checked that the history is not empty */
+    if (h->first == h->last) {
+        return h->value[h->last];
+    } else {
+        const gint64 dt = h->timestamp[h->last] - h->timestamp[h->first];
+
+        /* Integral area divided by time */
+        return (GUTIL_HISTORY_VALUE)(h->area/dt);
+    }
+}
+
+GUTIL_HISTORY_VALUE
+GUTIL_HISTORY_FN(add)(
+    GUTIL_HISTORY_TYPE* h,
+    GUTIL_HISTORY_VALUE value)
+{
+    if (G_LIKELY(h)) {
+	gint64 now = h->time();
+
+#ifdef GUTIL_HISTORY_VALUE_VALID
+        if (!GUTIL_HISTORY_VALUE_VALID(value)) {
+            /* Unordered values would break the tree and the deque */
+            return (h->last >= 0 && GUTIL_HISTORY_FN(flush)(h, now)) ?
+                GUTIL_HISTORY_FN(median_at)(h, now) : 0;
+        }
+#endif
+        if (h->last < 0 || !GUTIL_HISTORY_FN(flush)(h, now)) {
+            GUTIL_HISTORY_FN(reset)(h);
+            h->last = h->first = 0;
+        } else {
+            const gint64 last_time = h->timestamp[h->last];
+
+            if (now > last_time) {
+                /* Need a new entry */
+                const int next = GUTIL_HISTORY_FN(next)(h, h->last);
+
+                if (next == h->first) {
+                    if (h->first != h->last) {
+                        GUTIL_HISTORY_FN(drop_first)(h);
+                    } else {
+                        /* Single entry history */
+                        GUTIL_HISTORY_FN(tree_remove)(h, next);
+                        GUTIL_HISTORY_FN(minmax_drop)(h, next);
+                    }
+                }
+                h->timestamp[next] = now;
+                h->value[next] = value;
+                h->area += GUTIL_HISTORY_FN(segment)(h, h->last, next);
+                h->last = next;
+                GUTIL_HISTORY_FN(tree_insert)(h, next);
+                GUTIL_HISTORY_FN(minmax_push)(h, next);
+                GUTIL_HISTORY_FN(update_deadline)(h);
+                return GUTIL_HISTORY_FN(median_at)(h, now);
+            } else if (h->first != h->last) {
+                /* Replace the last value, keeping its timestamp */
+                const int prev = GUTIL_HISTORY_FN(prev)(h, h->last);
+                const GUTIL_HISTORY_VALUE old_value = h->value[h->last];
+
+                h->area -= GUTIL_HISTORY_FN(segment)(h, prev, h->last);
+                GUTIL_HISTORY_FN(tree_remove)(h, h->last);
+                h->value[h->last] = value;
+                GUTIL_HISTORY_FN(tree_insert)(h, h->last);
+                GUTIL_HISTORY_FN(minmax_replace)(h, old_value);
+                h->area += GUTIL_HISTORY_FN(segment)(h, prev, h->last);
+                GUTIL_HISTORY_FN(area_updated)(h);
+                return GUTIL_HISTORY_FN(median_at)(h, last_time);
+            }
+            /* Time goes back or stays the same? */
+            now = last_time;
+            GUTIL_HISTORY_FN(tree_remove)(h, h->last);
+            GUTIL_HISTORY_FN(minmax_drop)(h, h->last);
+        }
+        h->timestamp[h->last] = now;
+        h->value[h->last] = value;
+        GUTIL_HISTORY_FN(tree_insert)(h, h->last);
+        GUTIL_HISTORY_FN(minmax_push)(h, h->last);
+        GUTIL_HISTORY_FN(update_deadline)(h);
+        return GUTIL_HISTORY_FN(median_at)(h, now);
+    }
+    return 0;
+}
+
+GUTIL_HISTORY_VALUE
+GUTIL_HISTORY_FN(median)(
+    GUTIL_HISTORY_TYPE* h,
+    GUTIL_HISTORY_VALUE default_value)
+{
+    if (G_LIKELY(h) && h->last >= 0) {
+	const gint64 now = h->time();
+
+        if (GUTIL_HISTORY_FN(flush)(h, now)) {
+            return GUTIL_HISTORY_FN(median_at)(h, now);
+        }
+    }
+    return default_value;
+}
+
+GUTIL_HISTORY_VALUE
+GUTIL_HISTORY_FN(percentile)(
+    GUTIL_HISTORY_TYPE* h,
+    guint percent,
+    GUTIL_HISTORY_VALUE default_value)
+{
+    if (G_LIKELY(h) && h->last >= 0 && GUTIL_HISTORY_FN(flush)(h, h->time())) {
+        int n, rank;
+
+        if (!h->node) {
+            int pos = h->first;
+
+            /* Build the tree on demand, it's maintained from now on */
+            h->node = g_new(GUtilHistoryNode, h->max_size);
+            h->root = -1;
+            GUTIL_HISTORY_FN(tree_insert)(h, pos);
+            while (pos != h->last) {
+                pos = GUTIL_HISTORY_FN(next)(h, pos);
+                GUTIL_HISTORY_FN(tree_insert)(h, pos);
+            }
+        }
+
+        /* Nearest rank */
+        n = h->node[h->root].size;
+        rank = (int)((MIN(percent, 100) * (guint64)n + 99) / 100);
+        return GUTIL_HISTORY_FN(tree_at)(h, MAX(rank, 1) - 1);
+    }
+    return default_value;
+}
+
+static
+GUTIL_HISTORY_VALUE
+GUTIL_HISTORY_FN(extreme)(
+    GUTIL_HISTORY_TYPE* h,
+    int which,
+    GUTIL_HISTORY_VALUE default_value)
+{
+    if (G_LIKELY(h) && h->last >= 0 && GUTIL_HISTORY_FN(flush)(h, h->time())) {
+        GUtilHistoryDeque* d;
+
+        if (!h->minmax) {
+            /* Both deques and their slots in a single block */
+            int* slot;
+
+            h->minmax = g_malloc(2 * (sizeof(GUtilHistoryDeque) +
+                h->max_size * sizeof(int)));
+            slot = (int*)(h->minmax + 2);
+            h->minmax[0].slot = slot;
+            h->minmax[0].max = FALSE;
+            h->minmax[0].valid = FALSE;
+            h->minmax[1].slot = slot + h->max_size;
+            h->minmax[1].max = TRUE;
+            h->minmax[1].valid = FALSE;
+        }
+
+        d = h->minmax + which;
+        if (!d->valid) {
+            GUTIL_HISTORY_FN(deque_build)(h, d);
+        }
+        return h->value[d->slot[d->start]];
+    }
+    return default_value;
+}
+
+GUTIL_HISTORY_VALUE
+GUTIL_HISTORY_FN(min)(
+    GUTIL_HISTORY_TYPE* h,
+    GUTIL_HISTORY_VALUE default_value)
+{
+    return GUTIL_HISTORY_FN(extreme)(h, 0, default_value);
+}
+
+GUTIL_HISTORY_VALUE
+GUTIL_HISTORY_FN(max)(
+    GUTIL_HISTORY_TYPE* h,
+    GUTIL_HISTORY_VALUE default_value)
+{
+    return GUTIL_HISTORY_FN(extreme)(h, 1, default_value);
+}
+
+#undef GUTIL_HISTORY_FN
+#undef GUTIL_HISTORY_PASTE
+#undef GUTIL_HISTORY_PASTE_
+#undef GUTIL_HISTORY_AREA_EXACT
+#undef GUTIL_HISTORY_VALUE_VALID
+#undef GUTIL_HISTORY_AREA
+#undef GUTIL_HISTORY_VALUE
+#undef GUTIL_HISTORY_TYPE
+#undef GUTIL_HISTORY_STRUCT
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
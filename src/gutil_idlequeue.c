@@ -31,8 +31,9 @@
  */
 
 #include "gutil_idlequeue.h"
+#include "gutil_histogram.h"
+#include "gutil_impl.h"
 #include "gutil_macros.h"
-#include "gutil_misc.h"
 #include "gutil_log.h"
 
 #if __GNUC__ >= 4
@@ -41,67 +42,634 @@
 
 typedef struct gutil_idle_queue_item GUtilIdleQueueItem;
 
+/*
+ * Items are kept in doubly linked lists, one per priority class.
+ * Besides, they are indexed by tag (see gutil_tags_impl.h).
+ *
+ * Finished items are kept in the pool (linked through the next pointer)
+ * and reused, so that a queue in a steady state doesn't allocate any
+ * memory. The pool doesn't grow beyond the longest the queue has been.
+ *
+ * Items submitted by other threads are pushed to a lock-free stack
+ * (linked through the next pointer too) which is taken as a whole and
+ * moved to the lists by the event source, on the main thread.
+ *
+ * Timed items are kept in a binary heap ordered by the deadline (and
+ * the sequence number, to keep the order of items with the same
+ * deadline) until they are due. Then the event source moves them to
+ * the list. The event source computes its timeout from the earliest
+ * deadline.
+ *
+ * Statistics are only collected while enabled, otherwise the only
+ * overhead is checking the stats pointer. Items get timestamped when
+ * they are appended to the list (or submitted by another thread), and
+ * the depth counts the items in the lists. Items which were queued
+ * before the stats got enabled don't contribute to the wait histogram.
+ */
 struct gutil_idle_queue_item {
     GUtilIdleQueueItem* next;
+    GUtilIdleQueueItem* prev;
+    GUtilIdleQueueItem* tag_next;
+    GUtilIdleQueueItem* tag_prev;
     GUtilIdleQueueTag tag;
+    GUTIL_IDLE_QUEUE_PRIORITY priority;
     gpointer data;
     GUtilIdleFunc run;
     GFreeFunc destroy;
     gboolean completed;
+    guint gen;                          /* Dispatch when it was queued */
+    gboolean timed;                     /* In the heap */
+    guint heap_index;
+    guint seq;
+    gint64 deadline;
+    gint64 queued;                      /* Only if stats are enabled */
 };
 
-struct gutil_idle_queue {
-    gint ref_count;
-    guint source_id;
+#define GUTIL_TAGS_ITEM GUtilIdleQueueItem
+#define GUTIL_TAGS_TAG GUtilIdleQueueTag
+#define GUTIL_TAGS_FN(x) gutil_idle_queue_##x
+#include "gutil_tags_impl.h"
+
+typedef struct gutil_idle_queue_list {
     GUtilIdleQueueItem* first;
     GUtilIdleQueueItem* last;
+} GUtilIdleQueueList;
+
+#define GUTIL_IDLE_QUEUE_PRIORITY_COUNT (3)
+#define GUTIL_IDLE_QUEUE_STATS_MAX (60000000) /* 1 minute */
+#define GUTIL_IDLE_QUEUE_STATS_PRECISION (5)
+static const gint gutil_idle_queue_source_priority
+    [GUTIL_IDLE_QUEUE_PRIORITY_COUNT] = {
+    G_PRIORITY_HIGH_IDLE,               /* GUTIL_IDLE_QUEUE_PRIORITY_HIGH */
+    G_PRIORITY_DEFAULT_IDLE,            /* GUTIL_IDLE_QUEUE_PRIORITY_DEFAULT */
+    G_PRIORITY_LOW                      /* GUTIL_IDLE_QUEUE_PRIORITY_LOW */
+};
+
+typedef struct gutil_idle_queue_source {
+    GSource source;
+    GUtilIdleQueue* queue;
+} GUtilIdleQueueSource;
+
+struct gutil_idle_queue {
+    gint ref_count;
+    GSource* source;                    /* Created on demand */
+    gint source_priority;               /* G_MAXINT if nothing to run */
+    GSource* event_source;              /* Created on demand */
+    GUtilIdleQueueItem* submitted;      /* Pushed by other threads */
+    GUtilIdleQueueItem** heap;          /* Timed items */
+    guint heap_size;
+    guint heap_alloc;
+    guint seq;
+    GUtilIdleQueueStats* stats;         /* NULL if disabled */
+    guint gen;                          /* Dispatch counter */
+    GUtilIdleQueueList list[GUTIL_IDLE_QUEUE_PRIORITY_COUNT];
+    GUtilIdleQueueItem* pool;
+    GUtilTagIndex tags;
+    guint max_items;                    /* Per dispatch, zero if none */
+    gint64 max_time;                    /* Per dispatch, zero if none */
+    guint item_budget_hits;
+    guint time_budget_hits;
 };
 
+static inline
+GUTIL_IDLE_QUEUE_PRIORITY
+gutil_idle_queue_priority(
+    GUTIL_IDLE_QUEUE_PRIORITY priority)
+{
+    return ((guint)priority < GUTIL_IDLE_QUEUE_PRIORITY_COUNT) ? priority :
+        GUTIL_IDLE_QUEUE_PRIORITY_DEFAULT;
+}
+
+static
+void
+gutil_idle_queue_list_append(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueItem* item)
+{
+    GUtilIdleQueueList* list = q->list + item->priority;
+
+    if (G_UNLIKELY(q->stats)) {
+        GUtilIdleQueueStats* stats = q->stats;
+
+        if (!item->queued) {
+            item->queued = g_get_monotonic_time();
+        }
+        if (++stats->depth > stats->max_depth) {
+            stats->max_depth = stats->depth;
+        }
+    }
+    item->gen = q->gen;
+    item->prev = list->last;
+    if (list->last) {
+        GASSERT(list->first);
+        list->last->next = item;
+    } else {
+        GASSERT(!list->first);
+        list->first = item;
+    }
+    list->last = item;
+}
+
+static
+void
+gutil_idle_queue_list_remove(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueItem* item)
+{
+    GUtilIdleQueueList* list = q->list + item->priority;
+
+    if (G_UNLIKELY(q->stats)) {
+        q->stats->depth--;
+    }
+    if (item->prev) {
+        item->prev->next = item->next;
+    } else {
+        GASSERT(list->first == item);
+        list->first = item->next;
+    }
+    if (item->next) {
+        item->next->prev = item->prev;
+    } else {
+        GASSERT(list->last == item);
+        list->last = item->prev;
+    }
+    item->next = item->prev = NULL;
+}
+
+static inline
+gboolean
+gutil_idle_queue_heap_less(
+    const GUtilIdleQueueItem* a,
+    const GUtilIdleQueueItem* b)
+{
+    return a->deadline < b->deadline || (a->deadline == b->deadline &&
+        (gint)(a->seq - b->seq) < 0);
+}
+
+static inline
+void
+gutil_idle_queue_heap_set(
+    GUtilIdleQueue* q,
+    guint i,
+    GUtilIdleQueueItem* item)
+{
+    q->heap[i] = item;
+    item->heap_index = i;
+}
+
+static
+void
+gutil_idle_queue_heap_up(
+    GUtilIdleQueue* q,
+    guint i)
+{
+    GUtilIdleQueueItem* item = q->heap[i];
+
+    while (i > 0) {
+        const guint parent = (i - 1) / 2;
+
+        if (!gutil_idle_queue_heap_less(item, q->heap[parent])) {
+            break;
+        }
+        gutil_idle_queue_heap_set(q, i, q->heap[parent]);
+        i = parent;
+    }
+    gutil_idle_queue_heap_set(q, i, item);
+}
+
+static
+void
+gutil_idle_queue_heap_down(
+    GUtilIdleQueue* q,
+    guint i)
+{
+    GUtilIdleQueueItem* item = q->heap[i];
+    guint child;
+
+    while ((child = 2 * i + 1) < q->heap_size) {
+        if (child + 1 < q->heap_size &&
+            gutil_idle_queue_heap_less(q->heap[child + 1], q->heap[child])) {
+            child++;
+        }
+        if (!gutil_idle_queue_heap_less(q->heap[child], item)) {
+            break;
+        }
+        gutil_idle_queue_heap_set(q, i, q->heap[child]);
+        i = child;
+    }
+    gutil_idle_queue_heap_set(q, i, item);
+}
+
+static
+void
+gutil_idle_queue_heap_push(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueItem* item)
+{
+    if (q->heap_size == q->heap_alloc) {
+        q->heap_alloc = q->heap_alloc ? (2 * q->heap_alloc) : 8;
+        q->heap = g_renew(GUtilIdleQueueItem*, q->heap, q->heap_alloc);
+    }
+    item->timed = TRUE;
+    item->seq = q->seq++;
+    q->heap[q->heap_size++] = item;
+    gutil_idle_queue_heap_up(q, q->heap_size - 1);
+}
+
+static
+void
+gutil_idle_queue_heap_remove(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueItem* item)
+{
+    const guint i = item->heap_index;
+    GUtilIdleQueueItem* last = q->heap[--q->heap_size];
+
+    GASSERT(item->timed && q->heap[i] == item);
+    item->timed = FALSE;
+    if (last != item) {
+        gutil_idle_queue_heap_set(q, i, last);
+        if (i > 0 &&
+            gutil_idle_queue_heap_less(last, q->heap[(i - 1) / 2])) {
+            gutil_idle_queue_heap_up(q, i);
+        } else {
+            gutil_idle_queue_heap_down(q, i);
+        }
+    }
+}
+
+static
+void
+gutil_idle_queue_link(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueItem* item)
+{
+    gutil_idle_queue_list_append(q, item);
+    gutil_idle_queue_tag_link(&q->tags, item);
+}
+
+static
+void
+gutil_idle_queue_unlink(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueItem* item)
+{
+    if (item->timed) {
+        gutil_idle_queue_heap_remove(q, item);
+    } else {
+        gutil_idle_queue_list_remove(q, item);
+    }
+    gutil_idle_queue_tag_unlink(&q->tags, item);
+}
+
+static
+GUtilIdleQueueItem*
+gutil_idle_queue_item_new(
+    GUtilIdleQueue* q)
+{
+    GUtilIdleQueueItem* item = q->pool;
+
+    if (item) {
+        q->pool = item->next;
+        memset(item, 0, sizeof(*item));
+        return item;
+    } else {
+        return g_slice_new0(GUtilIdleQueueItem);
+    }
+}
+
 static
 void
 gutil_idle_queue_item_destroy(
+    GUtilIdleQueue* q,
     GUtilIdleQueueItem* item)
 {
     GASSERT(item->completed);
     if (item->destroy) {
         item->destroy(item->data);
     }
-    gutil_slice_free(item);
+    item->next = q->pool;
+    q->pool = item;
 }
 
+static
+void
+gutil_idle_queue_cancel_item(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueItem* item)
+{
+    gutil_idle_queue_unlink(q, item);
+    item->completed = TRUE;
+    gutil_idle_queue_item_destroy(q, item);
+}
+
+static
+GUtilIdleQueueItem*
+gutil_idle_queue_first(
+    GUtilIdleQueue* q)
+{
+    guint i;
+
+    /* The first item of the highest priority */
+    for (i = 0; i < GUTIL_IDLE_QUEUE_PRIORITY_COUNT; i++) {
+        if (q->list[i].first) {
+            return q->list[i].first;
+        }
+    }
+    return NULL;
+}
+
+static
+void
+gutil_idle_queue_run_item_stats(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueItem* item)
+{
+    const gint64 start = g_get_monotonic_time();
+
+    if (item->queued) {
+        gutil_histogram_add(q->stats->wait, start - item->queued);
+    }
+    if (item->run) {
+        item->run(item->data);
+    }
+
+    /* The callback may have disabled the stats */
+    if (q->stats) {
+        gutil_histogram_add(q->stats->run, g_get_monotonic_time() - start);
+    }
+}
+
+static
+void
+gutil_idle_queue_run(
+    GUtilIdleQueue* q);
+
 static
 gboolean
+gutil_idle_queue_idle_prepare(
+    GSource* source,
+    gint* timeout)
+{
+    GUtilIdleQueue* q = ((GUtilIdleQueueSource*)source)->queue;
+
+    *timeout = -1;
+    return gutil_idle_queue_first(q) != NULL;
+}
+
+static
+gboolean
+gutil_idle_queue_idle_check(
+    GSource* source)
+{
+    GUtilIdleQueue* q = ((GUtilIdleQueueSource*)source)->queue;
+
+    return gutil_idle_queue_first(q) != NULL;
+}
+
+static
+gboolean
+gutil_idle_queue_idle_dispatch(
+    GSource* source,
+    GSourceFunc callback,
+    gpointer user_data)
+{
+    gutil_idle_queue_run(((GUtilIdleQueueSource*)source)->queue);
+    return G_SOURCE_CONTINUE;
+}
+
+static
+void
+gutil_idle_queue_update_source(
+    GUtilIdleQueue* q)
+{
+    GUtilIdleQueueItem* first = gutil_idle_queue_first(q);
+
+    /* The source priority follows the highest priority pending item */
+    if (first) {
+        const gint priority = gutil_idle_queue_source_priority
+            [first->priority];
+
+        if (!q->source) {
+            static GSourceFuncs gutil_idle_queue_idle_funcs = {
+                gutil_idle_queue_idle_prepare,
+                gutil_idle_queue_idle_check,
+                gutil_idle_queue_idle_dispatch,
+                NULL
+            };
+
+            q->source = g_source_new(&gutil_idle_queue_idle_funcs,
+                sizeof(GUtilIdleQueueSource));
+            ((GUtilIdleQueueSource*)q->source)->queue = q;
+            g_source_set_priority(q->source, priority);
+            g_source_attach(q->source, g_main_context_default());
+        } else if (g_source_get_priority(q->source) != priority) {
+            /* Keep the source, only its priority changes */
+            g_source_set_priority(q->source, priority);
+        }
+        q->source_priority = priority;
+    } else {
+        /* The source stays, it's just not ready while the queue is empty */
+        q->source_priority = G_MAXINT;
+    }
+}
+
+static
+gboolean
+gutil_idle_queue_submitted(
+    GUtilIdleQueue* q)
+{
+    return g_atomic_pointer_get(&q->submitted) != NULL;
+}
+
+static
+void
+gutil_idle_queue_take_submitted(
+    GUtilIdleQueue* q)
+{
+    GUtilIdleQueueItem* item;
+    GUtilIdleQueueItem* list = NULL;
+
+    /* Take the whole stack */
+    do {
+        item = g_atomic_pointer_get(&q->submitted);
+    } while (!g_atomic_pointer_compare_and_exchange(&q->submitted,
+        item, NULL));
+
+    /* Reverse it to restore the submission order */
+    while (item) {
+        GUtilIdleQueueItem* next = item->next;
+
+        item->next = list;
+        list = item;
+        item = next;
+    }
+
+    /* And move the items to the queue */
+    while ((item = list) != NULL) {
+        list = item->next;
+        item->next = NULL;
+        gutil_idle_queue_link(q, item);
+    }
+}
+
+static
+void
+gutil_idle_queue_expire(
+    GUtilIdleQueue* q,
+    gint64 now)
+{
+    /* Move the items which are due to the list */
+    while (q->heap_size && q->heap[0]->deadline <= now) {
+        GUtilIdleQueueItem* item = q->heap[0];
+
+        gutil_idle_queue_heap_remove(q, item);
+        gutil_idle_queue_list_append(q, item);
+    }
+}
+
+static
+gboolean
+gutil_idle_queue_source_prepare(
+    GSource* source,
+    gint* timeout)
+{
+    GUtilIdleQueue* q = ((GUtilIdleQueueSource*)source)->queue;
+
+    *timeout = -1;
+    if (gutil_idle_queue_submitted(q)) {
+        return TRUE;
+    } else if (q->heap_size) {
+        const gint64 now = g_source_get_time(source);
+        const gint64 deadline = q->heap[0]->deadline;
+
+        if (deadline <= now) {
+            return TRUE;
+        } else {
+            *timeout = gutil_timeout_ms(deadline - now);
+        }
+    }
+    return FALSE;
+}
+
+static
+gboolean
+gutil_idle_queue_source_check(
+    GSource* source)
+{
+    GUtilIdleQueue* q = ((GUtilIdleQueueSource*)source)->queue;
+
+    return gutil_idle_queue_submitted(q) || (q->heap_size &&
+        q->heap[0]->deadline <= g_source_get_time(source));
+}
+
+static
+gboolean
+gutil_idle_queue_source_dispatch(
+    GSource* source,
+    GSourceFunc callback,
+    gpointer user_data)
+{
+    GUtilIdleQueue* q = ((GUtilIdleQueueSource*)source)->queue;
+
+    if (gutil_idle_queue_submitted(q)) {
+        gutil_idle_queue_take_submitted(q);
+    }
+    gutil_idle_queue_expire(q, g_source_get_time(source));
+    gutil_idle_queue_update_source(q);
+    return G_SOURCE_CONTINUE;
+}
+
+static
+GSource*
+gutil_idle_queue_event_source(
+    GUtilIdleQueue* q)
+{
+    GSource* source = g_atomic_pointer_get(&q->event_source);
+
+    if (!source) {
+        static GSourceFuncs gutil_idle_queue_source_funcs = {
+            gutil_idle_queue_source_prepare,
+            gutil_idle_queue_source_check,
+            gutil_idle_queue_source_dispatch,
+            NULL
+        };
+
+        /* Several threads may get here at the same time, one wins */
+        source = g_source_new(&gutil_idle_queue_source_funcs,
+            sizeof(GUtilIdleQueueSource));
+        ((GUtilIdleQueueSource*)source)->queue = q;
+        if (g_atomic_pointer_compare_and_exchange(&q->event_source,
+            NULL, source)) {
+            g_source_attach(source, g_main_context_default());
+        } else {
+            g_source_unref(source);
+            source = g_atomic_pointer_get(&q->event_source);
+        }
+    }
+    return source;
+}
+
+static
+void
 gutil_idle_queue_run(
-    gpointer data)
+    GUtilIdleQueue* q)
 {
-    GUtilIdleQueue* q = data;
     GUtilIdleQueueItem* item;
     GUtilIdleQueueItem* done = NULL;
+    GUtilIdleQueueItem* done_last = NULL;
+    const gint priority = q->source_priority;
+    const gint64 deadline = q->max_time ?
+        (g_get_monotonic_time() + q->max_time) : 0;
+    const guint gen = ++q->gen;
+    guint n = 0;
 
     /*
-     * Mark all currently existing items as as completed. Callbacks
-     * that we are about to invoke may add more items, those we are
-     * not supposed to run until the next idle loop. Also, note that
-     * callbacks may cancel some of the completed items, that's why
-     * we can't remove them from the list just yet.
+     * Only the items queued before this dispatch are invoked. Callbacks
+     * that we are about to invoke may add more items, those get the
+     * current generation and we are not supposed to run them until the
+     * next idle loop. Also, note that callbacks may cancel some of the
+     * remaining items, that's why we take them one by one. Unlike marking
+     * all the items upfront, this doesn't cost O(n) per dispatch when
+     * the budget leaves most of the queue for the next dispatches.
+     *
+     * Items are invoked in the order of priority. If a callback adds
+     * an item of a higher priority than the remaining ones, we stop
+     * and let it run first, on the next dispatch. Lower priority items
+     * are left for the dispatch at their own priority, so that they
+     * don't get ahead of the other idle sources.
      */
-    for (item = q->first; item; item = item->next) {
-        item->completed = TRUE;
-    }
+    while ((item = gutil_idle_queue_first(q)) && item->gen != gen &&
+        gutil_idle_queue_source_priority[item->priority] <= priority) {
+        /*
+         * If the budget is exhausted, leave the rest for the next
+         * dispatch. We run at least one item though.
+         */
+        if (n) {
+            if (q->max_items && n >= q->max_items) {
+                q->item_budget_hits++;
+                break;
+            } else if (deadline && g_get_monotonic_time() >= deadline) {
+                q->time_budget_hits++;
+                break;
+            }
+        }
+        n++;
 
-    while ((item = q->first) && item->completed) {
         /* Remove this one from the list */
-        q->first = item->next;
-        if (!q->first) {
-            q->last = NULL;
-        }
+        gutil_idle_queue_unlink(q, item);
 
         /* Place it to the "done" list */
         item->next = done;
         done = item;
+        if (!done_last) {
+            done_last = item;
+        }
 
         /* Invoke the callbacks */
-        if (item->run) {
+        if (G_UNLIKELY(q->stats)) {
+            gutil_idle_queue_run_item_stats(q, item);
+        } else if (item->run) {
             item->run(item->data);
         }
 
@@ -110,16 +678,17 @@ gutil_idle_queue_run(
         }
     }
 
-    /* Free the completed items */
-    g_slice_free_chain(GUtilIdleQueueItem, done, next);
-
-    if (q->first) {
-        /* New callbacks have been added */
-        return G_SOURCE_CONTINUE;
-    } else {
-        q->source_id = 0;
-        return G_SOURCE_REMOVE;
+    /* Return the completed items to the pool */
+    if (done) {
+        done_last->next = q->pool;
+        q->pool = done;
     }
+
+    /*
+     * New callbacks may have been added or the budget exhausted, the
+     * source priority may need to change.
+     */
+    gutil_idle_queue_update_source(q);
 }
 
 GUtilIdleQueue*
@@ -157,7 +726,20 @@ gutil_idle_queue_unref(
     if (G_LIKELY(q)) {
         GASSERT(q->ref_count > 0);
         if (g_atomic_int_dec_and_test(&q->ref_count)) {
+            if (q->event_source) {
+                g_source_destroy(q->event_source);
+                g_source_unref(q->event_source);
+                q->event_source = NULL;
+            }
             gutil_idle_queue_cancel_all(q);
+            if (q->source) {
+                g_source_destroy(q->source);
+                g_source_unref(q->source);
+            }
+            gutil_tag_index_clear(&q->tags);
+            g_free(q->heap);
+            gutil_idle_queue_set_stats_enabled(q, FALSE);
+            g_slice_free_chain(GUtilIdleQueueItem, q->pool, next);
             gutil_slice_free(q);
         }
     }
@@ -199,62 +781,271 @@ gutil_idle_queue_add_tag_full(
     GUtilIdleFunc run,
     gpointer data,
     GFreeFunc destroy)
+{
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_DEFAULT,
+        tag, run, data, destroy);
+}
+
+void
+gutil_idle_queue_add_priority(
+    GUtilIdleQueue* q,
+    GUTIL_IDLE_QUEUE_PRIORITY priority,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc destroy) /* Since 1.0.82 */
 {
     if (G_LIKELY(q)) {
-        GUtilIdleQueueItem* item = g_slice_new0(GUtilIdleQueueItem);
+        GUtilIdleQueueItem* item = gutil_idle_queue_item_new(q);
 
         /* Fill the item */
         item->tag = tag;
+        item->priority = gutil_idle_queue_priority(priority);
         item->run = run;
         item->destroy = destroy;
         item->data = data;
 
         /* Add it to the queue */
-        if (q->last) {
-            GASSERT(q->first);
-            q->last->next = item;
-        } else {
-            GASSERT(!q->first);
-            q->first = item;
-        }
-        q->last = item;
+        gutil_idle_queue_link(q, item);
 
-        /* Schedule the callback if necessary */
-        if (!q->source_id) {
-            q->source_id = g_idle_add(gutil_idle_queue_run, q);
+        /* Schedule (or reschedule) the callback if necessary */
+        if (!q->source || q->source_priority >
+            gutil_idle_queue_source_priority[item->priority]) {
+            gutil_idle_queue_update_source(q);
         }
     } else if (destroy) {
         destroy(data);
     }
 }
 
+void
+gutil_idle_queue_add_delayed(
+    GUtilIdleQueue* q,
+    guint delay_ms,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc destroy) /* Since 1.0.82 */
+{
+    gutil_idle_queue_add_deadline(q, g_get_monotonic_time() +
+        (gint64)delay_ms * 1000, tag, run, data, destroy);
+}
+
+void
+gutil_idle_queue_add_deadline(
+    GUtilIdleQueue* q,
+    gint64 deadline,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc destroy) /* Since 1.0.82 */
+{
+    if (G_LIKELY(q)) {
+        GUtilIdleQueueItem* item = gutil_idle_queue_item_new(q);
+
+        /* Fill the item */
+        item->tag = tag;
+        item->priority = GUTIL_IDLE_QUEUE_PRIORITY_DEFAULT;
+        item->run = run;
+        item->destroy = destroy;
+        item->data = data;
+        item->deadline = deadline;
+
+        /* Add it to the heap and to the tag index */
+        gutil_idle_queue_heap_push(q, item);
+        gutil_idle_queue_tag_link(&q->tags, item);
+
+        /* The event source picks up the new deadline when it polls */
+        gutil_idle_queue_event_source(q);
+    } else if (destroy) {
+        destroy(data);
+    }
+}
+
+void
+gutil_idle_queue_set_budget(
+    GUtilIdleQueue* q,
+    guint max_items,
+    gint64 max_time) /* Since 1.0.82 */
+{
+    if (G_LIKELY(q)) {
+        q->max_items = max_items;
+        q->max_time = MAX(max_time, 0);
+    }
+}
+
+void
+gutil_idle_queue_get_budget_hits(
+    GUtilIdleQueue* q,
+    guint* item_budget_hits,
+    guint* time_budget_hits) /* Since 1.0.82 */
+{
+    if (item_budget_hits) {
+        *item_budget_hits = G_LIKELY(q) ? q->item_budget_hits : 0;
+    }
+    if (time_budget_hits) {
+        *time_budget_hits = G_LIKELY(q) ? q->time_budget_hits : 0;
+    }
+}
+
+gboolean
+gutil_idle_queue_add_unique(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc destroy) /* Since 1.0.82 */
+{
+    if (G_LIKELY(q) && !gutil_idle_queue_find_tag(&q->tags, tag)) {
+        gutil_idle_queue_add_tag_full(q, tag, run, data, destroy);
+        return TRUE;
+    } else if (destroy) {
+        destroy(data);
+    }
+    return FALSE;
+}
+
 gboolean
-gutil_idle_queue_contains_tag(
+gutil_idle_queue_replace(
     GUtilIdleQueue* q,
-    GUtilIdleQueueTag tag)
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc destroy) /* Since 1.0.82 */
+{
+    GUtilIdleQueueItem* item = G_LIKELY(q) ?
+        gutil_idle_queue_find_tag(&q->tags, tag) : NULL;
+
+    if (item) {
+        GFreeFunc old_destroy = item->destroy;
+        gpointer old_data = item->data;
+
+        /* Update the item before invoking the callback */
+        item->run = run;
+        item->data = data;
+        item->destroy = destroy;
+        if (old_destroy) {
+            old_destroy(old_data);
+        }
+        return TRUE;
+    } else {
+        gutil_idle_queue_add_tag_full(q, tag, run, data, destroy);
+        return FALSE;
+    }
+}
+
+void
+gutil_idle_queue_submit(
+    GUtilIdleQueue* q,
+    GUTIL_IDLE_QUEUE_PRIORITY priority,
+    GUtilIdleQueueTag tag,
+    GUtilIdleFunc run,
+    gpointer data,
+    GFreeFunc destroy) /* Since 1.0.82 */
 {
     if (G_LIKELY(q)) {
-        const GUtilIdleQueueItem* item;
-        for (item = q->first; item; item = item->next) {
-            if (item->tag == tag) {
-                return TRUE;
+        GUtilIdleQueueItem* item = g_slice_new0(GUtilIdleQueueItem);
+        GUtilIdleQueueItem* next;
+
+        item->tag = tag;
+        item->priority = gutil_idle_queue_priority(priority);
+        item->run = run;
+        item->destroy = destroy;
+        item->data = data;
+        if (g_atomic_pointer_get(&q->stats)) {
+            item->queued = g_get_monotonic_time();
+        }
+
+        /* Push it to the stack */
+        do {
+            next = g_atomic_pointer_get(&q->submitted);
+            item->next = next;
+        } while (!g_atomic_pointer_compare_and_exchange(&q->submitted,
+            next, item));
+
+        /* Only the first submission needs to wake up the main loop */
+        if (!next) {
+            gutil_idle_queue_event_source(q);
+            g_main_context_wakeup(g_main_context_default());
+        }
+    } else if (destroy) {
+        destroy(data);
+    }
+}
+
+void
+gutil_idle_queue_set_stats_enabled(
+    GUtilIdleQueue* q,
+    gboolean enabled) /* Since 1.0.82 */
+{
+    if (G_LIKELY(q)) {
+        if (enabled && !q->stats) {
+            GUtilIdleQueueStats* stats = g_slice_new0(GUtilIdleQueueStats);
+            guint i;
+
+            stats->wait = gutil_histogram_new(GUTIL_IDLE_QUEUE_STATS_MAX,
+                GUTIL_IDLE_QUEUE_STATS_PRECISION);
+            stats->run = gutil_histogram_new(GUTIL_IDLE_QUEUE_STATS_MAX,
+                GUTIL_IDLE_QUEUE_STATS_PRECISION);
+
+            /* Count what's already there */
+            for (i = 0; i < GUTIL_IDLE_QUEUE_PRIORITY_COUNT; i++) {
+                GUtilIdleQueueItem* item;
+
+                for (item = q->list[i].first; item; item = item->next) {
+                    stats->depth++;
+                }
             }
+            stats->max_depth = stats->depth;
+            g_atomic_pointer_set(&q->stats, stats);
+        } else if (!enabled && q->stats) {
+            GUtilIdleQueueStats* stats = q->stats;
+
+            g_atomic_pointer_set(&q->stats, NULL);
+            gutil_histogram_unref(stats->wait);
+            gutil_histogram_unref(stats->run);
+            gutil_slice_free(stats);
         }
     }
-    return FALSE;
 }
 
-static
+gboolean
+gutil_idle_queue_get_stats(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueStats* stats) /* Since 1.0.82 */
+{
+    if (G_LIKELY(q) && q->stats) {
+        if (stats) {
+            *stats = *q->stats;
+        }
+        return TRUE;
+    } else {
+        if (stats) {
+            memset(stats, 0, sizeof(*stats));
+        }
+        return FALSE;
+    }
+}
+
 void
-gutil_idle_queue_cancel_first(
-    GUtilIdleQueue* q)
+gutil_idle_queue_reset_stats(
+    GUtilIdleQueue* q) /* Since 1.0.82 */
 {
-    GUtilIdleQueueItem* item = q->first;
-    q->first = item->next;
-    if (!q->first) {
-        q->last = NULL;
+    if (G_LIKELY(q) && q->stats) {
+        GUtilIdleQueueStats* stats = q->stats;
+
+        gutil_histogram_clear(stats->wait);
+        gutil_histogram_clear(stats->run);
+        stats->max_depth = stats->depth;
     }
-    gutil_idle_queue_item_destroy(item);
+}
+
+gboolean
+gutil_idle_queue_contains_tag(
+    GUtilIdleQueue* q,
+    GUtilIdleQueueTag tag)
+{
+    return G_LIKELY(q) && gutil_idle_queue_find_tag(&q->tags, tag);
 }
 
 gboolean
@@ -262,32 +1053,14 @@ gutil_idle_queue_cancel_tag(
     GUtilIdleQueue* q,
     GUtilIdleQueueTag tag)
 {
-    if (G_LIKELY(q) && q->first) {
-        GUtilIdleQueueItem* item = q->first;
-        if (item->tag == tag) {
-            item->completed = TRUE;
-            gutil_idle_queue_cancel_first(q);
-            GASSERT(q->source_id);
-            if (!q->first) {
-                gutil_source_clear(&q->source_id);
-            }
+    if (G_LIKELY(q)) {
+        GUtilIdleQueueItem* item = gutil_idle_queue_find_tag(&q->tags,
+            tag);
+
+        if (item) {
+            gutil_idle_queue_cancel_item(q, item);
+            gutil_idle_queue_update_source(q);
             return TRUE;
-        } else {
-            GUtilIdleQueueItem* prev = item;
-            for (item = item->next; item; prev = item, item = item->next) {
-                if (item->tag == tag) {
-                    if (item->next) {
-                        prev->next = item->next;
-                    } else {
-                        GASSERT(q->last == item);
-                        prev->next = NULL;
-                        q->last = prev;
-                    }
-                    item->completed = TRUE;
-                    gutil_idle_queue_item_destroy(item);
-                    return TRUE;
-                }
-            }
         }
     }
     return FALSE;
@@ -298,16 +1071,68 @@ gutil_idle_queue_cancel_all(
     GUtilIdleQueue* q)
 {
     if (G_LIKELY(q)) {
+        GUtilIdleQueueItem** heap = q->heap;
+        const guint n = q->heap_size;
+        GUtilIdleQueueItem* items = NULL;
+        GUtilIdleQueueItem* last = NULL;
         GUtilIdleQueueItem* item;
-        for (item = q->first; item; item = item->next) {
+        guint i;
+
+        /* Submitted items are cancelled too */
+        if (gutil_idle_queue_submitted(q)) {
+            gutil_idle_queue_take_submitted(q);
+        }
+
+        /*
+         * Detach everything first, destroy callbacks may add new items
+         * and those have to stay in the queue. Lists get chained in the
+         * order of priority.
+         */
+        for (i = 0; i < GUTIL_IDLE_QUEUE_PRIORITY_COUNT; i++) {
+            GUtilIdleQueueList* list = q->list + i;
+
+            if (list->first) {
+                if (last) {
+                    last->next = list->first;
+                } else {
+                    items = list->first;
+                }
+                last = list->last;
+                list->first = list->last = NULL;
+            }
+        }
+        for (item = items; item; item = item->next) {
+            if (G_UNLIKELY(q->stats)) {
+                q->stats->depth--;
+            }
+            gutil_idle_queue_tag_unlink(&q->tags, item);
             item->completed = TRUE;
         }
-        while (q->first && q->first->completed) {
-            gutil_idle_queue_cancel_first(q);
+
+        /* And so are the timed ones */
+        if (n) {
+            q->heap = NULL;
+            q->heap_size = q->heap_alloc = 0;
+            for (i = 0; i < n; i++) {
+                item = heap[i];
+                gutil_idle_queue_tag_unlink(&q->tags, item);
+                item->timed = FALSE;
+                item->completed = TRUE;
+            }
+        }
+
+        /* Now it's safe to invoke the callbacks */
+        while ((item = items) != NULL) {
+            items = item->next;
+            gutil_idle_queue_item_destroy(q, item);
         }
-        if (!q->first) {
-            gutil_source_clear(&q->source_id);
+        if (n) {
+            for (i = 0; i < n; i++) {
+                gutil_idle_queue_item_destroy(q, heap[i]);
+            }
+            g_free(heap);
         }
+        gutil_idle_queue_update_source(q);
     }
 }
 
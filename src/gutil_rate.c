@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gutil_rate.h"
+#include "gutil_impl.h"
+#include "gutil_log.h"
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+#define GUTIL_RATE_DEFAULT_TIME_FUNC g_get_monotonic_time
+
+/*
+ * The counters are unsigned and wrap around, which is what we want for
+ * the total. The atomic variant passes them to g_atomic_int_xxx() which
+ * wants gint pointers, hence the casts.
+ */
+struct gutil_rate {
+    gint ref_count;
+    gboolean atomic;
+    GUtilHistoryTimeFunc time;
+    GMutex mutex;                       /* Only used if atomic */
+    gint64 width;                       /* Bucket width */
+    gint64 start;                       /* When we started counting */
+    gint64 head;                        /* The current slot */
+    gint head_bits;                     /* Lower bits of the head */
+    guint total;                        /* Sum of all buckets */
+    guint size;                         /* Number of buckets */
+    guint bucket[1];
+};
+
+static inline
+guint*
+gutil_rate_bucket(
+    GUtilRate* r,
+    gint64 slot)
+{
+    const gint64 i = slot % r->size;
+
+    return r->bucket + ((i >= 0) ? i : (i + r->size));
+}
+
+static
+void
+gutil_rate_reset(
+    GUtilRate* r,
+    guint* bucket)
+{
+    if (r->atomic) {
+        guint count;
+
+        /* This may race with the lock-free gutil_rate_mark() */
+        do {
+            count = (guint)g_atomic_int_get((gint*)bucket);
+        } while (!g_atomic_int_compare_and_exchange((gint*)bucket,
+            (gint)count, 0));
+        g_atomic_int_add((gint*)&r->total, -(gint)count);
+    } else {
+        r->total -= *bucket;
+        *bucket = 0;
+    }
+}
+
+static
+void
+gutil_rate_set_head(
+    GUtilRate* r,
+    gint64 slot)
+{
+    r->head = slot;
+    if (r->atomic) {
+        g_atomic_int_set(&r->head_bits, (gint)slot);
+    }
+}
+
+static
+void
+gutil_rate_advance(
+    GUtilRate* r,
+    gint64 slot)
+{
+    /* Must be called under the mutex by the atomic variant */
+    if (slot > r->head) {
+        const gint64 n = MIN(slot - r->head, r->size);
+        gint64 i;
+
+        /* Buckets of the new slots contain the ones leaving the window */
+        for (i = 1; i <= n; i++) {
+            gutil_rate_reset(r, gutil_rate_bucket(r, r->head + i));
+        }
+        gutil_rate_set_head(r, slot);
+    }
+}
+
+static
+void
+gutil_rate_add(
+    GUtilRate* r,
+    gint64 slot,
+    guint count)
+{
+    /* Must be called under the mutex by the atomic variant */
+    gutil_rate_advance(r, slot);
+    if (slot > r->head - r->size) {
+        guint* bucket = gutil_rate_bucket(r, slot);
+
+        /* Lock-free marks may be updating the current bucket */
+        if (r->atomic) {
+            g_atomic_int_add((gint*)bucket, (gint)count);
+            g_atomic_int_add((gint*)&r->total, (gint)count);
+        } else {
+            *bucket += count;
+            r->total += count;
+        }
+    }
+}
+
+static
+guint
+gutil_rate_update(
+    GUtilRate* r,
+    gint64* elapsed)
+{
+    const gint64 now = r->time();
+    const gint64 window = (r->size - 1) * r->width;
+    guint total;
+
+    if (r->atomic) {
+        g_mutex_lock(&r->mutex);
+    }
+    gutil_rate_advance(r, gutil_div_floor(now, r->width));
+    if (elapsed) {
+        /* The time covered by the window, at least one bucket */
+        *elapsed = MAX(MIN(now - r->start, now - r->head * r->width +
+            window), r->width);
+    }
+    if (r->atomic) {
+        total = (guint)g_atomic_int_get((gint*)&r->total);
+        g_mutex_unlock(&r->mutex);
+    } else {
+        total = r->total;
+    }
+    return total;
+}
+
+GUtilRate*
+gutil_rate_new(
+    gint64 interval,
+    guint buckets)
+{
+    return gutil_rate_new_full(interval, buckets, NULL, GUTIL_RATE_NO_FLAGS);
+}
+
+GUtilRate*
+gutil_rate_new_full(
+    gint64 interval,
+    guint buckets,
+    GUtilHistoryTimeFunc fn,
+    GUTIL_RATE_FLAGS flags)
+{
+    if (buckets > 0 && interval >= buckets) {
+        GUtilRate* r = g_malloc0(sizeof(GUtilRate) +
+            (buckets - 1) * sizeof(r->bucket[0]));
+
+        g_atomic_int_set(&r->ref_count, 1);
+        r->atomic = (flags & GUTIL_RATE_FLAG_ATOMIC) != 0;
+        if (r->atomic) {
+            g_mutex_init(&r->mutex);
+        }
+        r->time = fn ? fn : GUTIL_RATE_DEFAULT_TIME_FUNC;
+        r->size = buckets;
+        r->width = interval / buckets;
+        r->start = r->time();
+        gutil_rate_set_head(r, gutil_div_floor(r->start, r->width));
+        return r;
+    }
+    return NULL;
+}
+
+GUtilRate*
+gutil_rate_ref(
+    GUtilRate* r)
+{
+    if (G_LIKELY(r)) {
+        GASSERT(r->ref_count > 0);
+        g_atomic_int_inc(&r->ref_count);
+    }
+    return r;
+}
+
+void
+gutil_rate_unref(
+    GUtilRate* r)
+{
+    if (G_LIKELY(r)) {
+        GASSERT(r->ref_count > 0);
+        if (g_atomic_int_dec_and_test(&r->ref_count)) {
+            if (r->atomic) {
+                g_mutex_clear(&r->mutex);
+            }
+            g_free(r);
+        }
+    }
+}
+
+void
+gutil_rate_clear(
+    GUtilRate* r)
+{
+    if (G_LIKELY(r)) {
+        guint i;
+
+        if (r->atomic) {
+            g_mutex_lock(&r->mutex);
+        }
+        for (i = 0; i < r->size; i++) {
+            gutil_rate_reset(r, r->bucket + i);
+        }
+        r->start = r->time();
+        gutil_rate_set_head(r, gutil_div_floor(r->start, r->width));
+        if (r->atomic) {
+            g_mutex_unlock(&r->mutex);
+        }
+    }
+}
+
+void
+gutil_rate_mark(
+    GUtilRate* r,
+    guint count)
+{
+    if (G_LIKELY(r) && count) {
+        const gint64 slot = gutil_div_floor(r->time(), r->width);
+
+        if (!r->atomic) {
+            gutil_rate_add(r, slot, count);
+        } else if (g_atomic_int_get(&r->head_bits) == (gint)slot) {
+            /*
+             * The current bucket, most likely. The lower bits may also
+             * match after a very long pause, but the worst that can
+             * happen then is that the stale buckets live a bit longer.
+             */
+            g_atomic_int_add((gint*)gutil_rate_bucket(r, slot), (gint)count);
+            g_atomic_int_add((gint*)&r->total, (gint)count);
+        } else {
+            g_mutex_lock(&r->mutex);
+            gutil_rate_add(r, slot, count);
+            g_mutex_unlock(&r->mutex);
+        }
+    }
+}
+
+guint
+gutil_rate_count(
+    GUtilRate* r)
+{
+    return G_LIKELY(r) ? gutil_rate_update(r, NULL) : 0;
+}
+
+double
+gutil_rate_get(
+    GUtilRate* r)
+{
+    if (G_LIKELY(r)) {
+        gint64 elapsed;
+        const guint total = gutil_rate_update(r, &elapsed);
+
+        return (double)total * GUTIL_HISTORY_SEC / elapsed;
+    }
+    return 0;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -38,6 +38,29 @@
 #pragma GCC visibility push(default)
 #endif
 
+/*
+ * In segmented mode the elements are stored in fixed size blocks.
+ * The ring only keeps a circular array of block pointers, so growing
+ * and shrinking never moves the elements themselves. A few released
+ * blocks are kept around to avoid reallocating them when the ring
+ * keeps oscillating around a block boundary.
+ */
+
+#define GUTIL_RING_DEFAULT_BLOCK_SIZE (128)
+#define GUTIL_RING_BLOCK_CACHE_SIZE (2)
+
+typedef struct gutil_ring_blocks {
+    gint size;                          /* Elements per block */
+    gint first;                         /* First element in the first block */
+    gint count;                         /* Number of elements */
+    gint map_alloc;                     /* Size of the block map */
+    gint map_start;                     /* Index of the first block */
+    gint map_count;                     /* Number of blocks in use */
+    gpointer** map;                     /* Circular array of blocks */
+    gint cached;                        /* Number of cached blocks */
+    gpointer* cache[GUTIL_RING_BLOCK_CACHE_SIZE];
+} GUtilRingBlocks;
+
 struct gutil_ring {
     gint ref_count;
     gint alloc;
@@ -46,8 +69,284 @@ struct gutil_ring {
     gint end;
     gpointer* data;
     GDestroyNotify free_func;
+    GUTIL_RING_FLAGS flags;
+    GUtilRingBlocks* blocks;            /* Only in segmented mode */
 };
 
+static inline
+gpointer*
+gutil_ring_block(
+    GUtilRingBlocks* b,
+    gint i)
+{
+    return b->map[(b->map_start + i) % b->map_alloc];
+}
+
+static inline
+gpointer*
+gutil_ring_block_slot(
+    GUtilRingBlocks* b,
+    gint pos)
+{
+    const gint k = b->first + pos;
+
+    return gutil_ring_block(b, k / b->size) + (k % b->size);
+}
+
+static
+void
+gutil_ring_blocks_reserve_map(
+    GUtilRingBlocks* b,
+    gint n)
+{
+    if (n > b->map_alloc) {
+        /* Only block pointers get copied, not the elements */
+        const gint alloc = MAX(n, b->map_alloc * 2);
+        gpointer** map = g_new(gpointer*, alloc);
+        gint i;
+
+        for (i = 0; i < b->map_count; i++) {
+            map[i] = gutil_ring_block(b, i);
+        }
+        g_free(b->map);
+        b->map = map;
+        b->map_alloc = alloc;
+        b->map_start = 0;
+    }
+}
+
+static
+gpointer*
+gutil_ring_blocks_alloc(
+    GUtilRingBlocks* b)
+{
+    return b->cached ? b->cache[--b->cached] : g_new(gpointer, b->size);
+}
+
+static
+void
+gutil_ring_blocks_release(
+    GUtilRingBlocks* b,
+    gpointer* block)
+{
+    if (b->cached < GUTIL_RING_BLOCK_CACHE_SIZE) {
+        b->cache[b->cached++] = block;
+    } else {
+        g_free(block);
+    }
+}
+
+static
+void
+gutil_ring_blocks_push_back(
+    GUtilRingBlocks* b)
+{
+    gutil_ring_blocks_reserve_map(b, b->map_count + 1);
+    b->map[(b->map_start + b->map_count) % b->map_alloc] =
+        gutil_ring_blocks_alloc(b);
+    b->map_count++;
+}
+
+static
+void
+gutil_ring_blocks_push_front(
+    GUtilRingBlocks* b)
+{
+    gutil_ring_blocks_reserve_map(b, b->map_count + 1);
+    b->map_start = (b->map_start + b->map_alloc - 1) % b->map_alloc;
+    b->map[b->map_start] = gutil_ring_blocks_alloc(b);
+    b->map_count++;
+}
+
+static
+void
+gutil_ring_blocks_trim(
+    GUtilRingBlocks* b)
+{
+    /* Release the blocks which no longer contain any elements */
+    if (b->count > 0) {
+        const gint needed = (b->first + b->count + b->size - 1) / b->size;
+
+        while (b->first >= b->size) {
+            gutil_ring_blocks_release(b, b->map[b->map_start]);
+            b->map_start = (b->map_start + 1) % b->map_alloc;
+            b->map_count--;
+            b->first -= b->size;
+        }
+        while (b->map_count > needed) {
+            b->map_count--;
+            gutil_ring_blocks_release(b, gutil_ring_block(b, b->map_count));
+        }
+    } else {
+        while (b->map_count > 0) {
+            b->map_count--;
+            gutil_ring_blocks_release(b, gutil_ring_block(b, b->map_count));
+        }
+        b->map_start = b->first = 0;
+    }
+}
+
+static
+void
+gutil_ring_blocks_put(
+    GUtilRingBlocks* b,
+    gpointer data)
+{
+    if (b->first + b->count == b->map_count * b->size) {
+        gutil_ring_blocks_push_back(b);
+    }
+    *gutil_ring_block_slot(b, b->count++) = data;
+}
+
+static
+void
+gutil_ring_blocks_put_front(
+    GUtilRingBlocks* b,
+    gpointer data)
+{
+    if (!b->first) {
+        gutil_ring_blocks_push_front(b);
+        b->first = b->size;
+    }
+    b->first--;
+    b->count++;
+    *gutil_ring_block_slot(b, 0) = data;
+}
+
+static
+gpointer
+gutil_ring_blocks_get(
+    GUtilRingBlocks* b)
+{
+    gpointer data = *gutil_ring_block_slot(b, 0);
+
+    b->first++;
+    b->count--;
+    gutil_ring_blocks_trim(b);
+    return data;
+}
+
+static
+gpointer
+gutil_ring_blocks_get_last(
+    GUtilRingBlocks* b)
+{
+    gpointer data = *gutil_ring_block_slot(b, --b->count);
+
+    gutil_ring_blocks_trim(b);
+    return data;
+}
+
+static
+void
+gutil_ring_blocks_free(
+    GUtilRingBlocks* b)
+{
+    gint i;
+
+    b->count = 0;
+    gutil_ring_blocks_trim(b);
+    for (i = 0; i < b->cached; i++) {
+        g_free(b->cache[i]);
+    }
+    g_free(b->map);
+    g_free(b);
+}
+
+/*
+ * Returns i-th contiguous segment of the ring contents. A plain ring
+ * has at most two segments, a segmented one has one per block.
+ */
+static
+gpointer*
+gutil_ring_segment(
+    GUtilRing* r,
+    gint i,
+    gint* len)
+{
+    if (r->blocks) {
+        GUtilRingBlocks* b = r->blocks;
+
+        if (i < b->map_count) {
+            const gint before = i ? (i * b->size - b->first) : 0;
+            const gint off = i ? 0 : b->first;
+
+            if (before < b->count) {
+                *len = MIN(b->size - off, b->count - before);
+                return gutil_ring_block(b, i) + off;
+            }
+        }
+    } else if (r->start >= 0) {
+        if (!i) {
+            *len = ((r->start < r->end) ? r->end : r->alloc) - r->start;
+            return r->data + r->start;
+        } else if (i == 1 && r->start >= r->end && r->end > 0) {
+            *len = r->end;
+            return r->data;
+        }
+    }
+    return NULL;
+}
+
+static
+void
+gutil_ring_free_all(
+    GUtilRing* r)
+{
+    GDestroyNotify free_func = r->free_func;
+    GUtilRing copy = *r;
+    GUtilRingBlocks blocks;
+    gpointer* ptr;
+    gint i, n;
+
+    /*
+     * Detach the contents first and leave the ring empty, in case
+     * if the free function touches the ring.
+     */
+    if (r->blocks) {
+        GUtilRingBlocks* b = r->blocks;
+
+        blocks = *b;
+        blocks.cached = 0;
+        copy.blocks = &blocks;
+        b->first = b->count = 0;
+        b->map_alloc = b->map_start = b->map_count = 0;
+        b->map = NULL;
+    } else {
+        r->start = r->end = -1;
+        r->alloc = 0;
+        r->data = NULL;
+    }
+
+    for (i = 0; (ptr = gutil_ring_segment(&copy, i, &n)) != NULL; i++) {
+        gpointer* end = ptr + n;
+
+        while (ptr < end) {
+            free_func(*ptr++);
+        }
+    }
+
+    /* Reuse the storage, unless something has been added meanwhile */
+    if (r->blocks) {
+        GUtilRingBlocks* b = r->blocks;
+
+        for (i = 0; i < blocks.map_count; i++) {
+            gutil_ring_blocks_release(b, gutil_ring_block(&blocks, i));
+        }
+        if (!b->map) {
+            b->map = blocks.map;
+            b->map_alloc = blocks.map_alloc;
+        } else {
+            g_free(blocks.map);
+        }
+    } else if (!r->data) {
+        r->data = copy.data;
+        r->alloc = copy.alloc;
+    } else {
+        g_free(copy.data);
+    }
+}
+
 GUtilRing*
 gutil_ring_new()
 {
@@ -81,6 +380,20 @@ gutil_ring_new_full(
     return r;
 }
 
+GUtilRing*
+gutil_ring_segmented_new(
+    gint block_size,
+    gint max_size,
+    GDestroyNotify free_func)
+{
+    GUtilRing* r = gutil_ring_new_full(0, max_size, free_func);
+    GUtilRingBlocks* b = g_new0(GUtilRingBlocks, 1);
+
+    b->size = (block_size > 0) ? block_size : GUTIL_RING_DEFAULT_BLOCK_SIZE;
+    r->blocks = b;
+    return r;
+}
+
 GUtilRing*
 gutil_ring_ref(
     GUtilRing* r)
@@ -100,12 +413,10 @@ gutil_ring_unref(
         GASSERT(r->ref_count > 0);
         if (g_atomic_int_dec_and_test(&r->ref_count)) {
             if (r->free_func) {
-                const gint n = gutil_ring_size(r);
-                gint i;
-
-                for (i=0; i<n; i++) {
-                    r->free_func(r->data[(r->start + i) % r->alloc]);
-                }
+                gutil_ring_free_all(r);
+            }
+            if (r->blocks) {
+                gutil_ring_blocks_free(r->blocks);
             }
             g_free(r->data);
             gutil_slice_free(r);
@@ -123,6 +434,23 @@ gutil_ring_set_free_func(
     }
 }
 
+GUTIL_RING_FLAGS
+gutil_ring_flags(
+    GUtilRing* r)
+{
+    return G_LIKELY(r) ? r->flags : GUTIL_RING_NO_FLAGS;
+}
+
+void
+gutil_ring_set_flags(
+    GUtilRing* r,
+    GUTIL_RING_FLAGS flags)
+{
+    if (G_LIKELY(r)) {
+        r->flags = flags;
+    }
+}
+
 gint
 gutil_ring_max_size(
     GUtilRing* r)
@@ -151,7 +479,11 @@ gint
 gutil_ring_size(
     GUtilRing* r)
 {
-    if (G_LIKELY(r) && r->start >= 0) {
+    if (G_UNLIKELY(!r)) {
+        return 0;
+    } else if (r->blocks) {
+        return r->blocks->count;
+    } else if (r->start >= 0) {
         if (r->start > r->end) {
             return (r->alloc + r->end - r->start);
         } else if (r->end > r->start) {
@@ -169,20 +501,50 @@ void
 gutil_ring_clear(
     GUtilRing* r)
 {
-    if (G_LIKELY(r)) {
-        gint n = gutil_ring_size(r);
-        if (n > 0) {
-            GDestroyNotify free_func = r->free_func;
-
-            if (free_func) {
-                do {
-                    free_func(gutil_ring_get(r));
-                    n--;
-                } while (n > 0 && gutil_ring_size(r) > 0);
-            } else {
-                r->start = r->end = -1;
+    if (G_LIKELY(r) && gutil_ring_size(r) > 0) {
+        if (r->free_func) {
+            gutil_ring_free_all(r);
+        } else if (r->blocks) {
+            r->blocks->count = 0;
+            gutil_ring_blocks_trim(r->blocks);
+        } else {
+            r->start = r->end = -1;
+        }
+    }
+}
+
+static
+void
+gutil_ring_blocks_compact(
+    GUtilRing* r)
+{
+    GUtilRingBlocks* b = r->blocks;
+
+    /* Drop the cached blocks and the flattened copy */
+    while (b->cached > 0) {
+        g_free(b->cache[--b->cached]);
+    }
+    g_free(r->data);
+    r->data = NULL;
+    r->alloc = 0;
+
+    /* Shrink the block map */
+    if (b->map_alloc > b->map_count) {
+        if (b->map_count > 0) {
+            gpointer** map = g_new(gpointer*, b->map_count);
+            gint i;
+
+            for (i = 0; i < b->map_count; i++) {
+                map[i] = gutil_ring_block(b, i);
             }
+            g_free(b->map);
+            b->map = map;
+        } else {
+            g_free(b->map);
+            b->map = NULL;
         }
+        b->map_alloc = b->map_count;
+        b->map_start = 0;
     }
 }
 
@@ -190,7 +552,11 @@ void
 gutil_ring_compact(
     GUtilRing* r)
 {
-    if (G_LIKELY(r)) {
+    if (G_UNLIKELY(!r)) {
+        return;
+    } else if (r->blocks) {
+        gutil_ring_blocks_compact(r);
+    } else {
         int n = gutil_ring_size(r);
 
         if (r->alloc > n) {
@@ -225,7 +591,17 @@ gutil_ring_reserve(
     gint minsize)
 {
     if (G_LIKELY(r)) {
-        if (minsize <= r->alloc) {
+        if (r->blocks) {
+            GUtilRingBlocks* b = r->blocks;
+
+            /* Blocks are allocated on demand, only reserve the map */
+            if (r->maxsiz >= 0 && minsize > r->maxsiz) {
+                return FALSE;
+            }
+            gutil_ring_blocks_reserve_map(b, (b->first + minsize +
+                b->size - 1) / b->size);
+            return TRUE;
+        } else if (minsize <= r->alloc) {
             /* The buffer is already large enough */
             return TRUE;
         } else if (r->maxsiz >= 0 && r->alloc >= r->maxsiz) {
@@ -271,17 +647,60 @@ gutil_ring_can_put(
     gint n)
 {
     if (G_LIKELY(r)) {
-        return r->maxsiz < 0 || (gutil_ring_size(r) + n) <= r->maxsiz;
+        return r->maxsiz < 0 || (gutil_ring_size(r) + n) <= r->maxsiz ||
+            ((r->flags & GUTIL_RING_FLAG_OVERWRITE) && n <= r->maxsiz);
     }
     return FALSE;
 }
 
+static
+gboolean
+gutil_ring_overwrite(
+    GUtilRing* r,
+    gpointer data)
+{
+    /* The caller has made sure that the ring is full and not empty */
+    gpointer old;
+
+    if (r->blocks) {
+        old = gutil_ring_blocks_get(r->blocks);
+        gutil_ring_blocks_put(r->blocks, data);
+    } else {
+        old = r->data[r->start];
+        if (r->start == r->end) {
+            /* The buffer is fully occupied, replace the oldest element */
+            r->data[r->end++] = data;
+            r->start = (r->end %= r->alloc);
+        } else {
+            /* The buffer is larger than the maximum size */
+            r->start = (r->start + 1) % r->alloc;
+            r->data[r->end++] = data;
+            r->end %= r->alloc;
+        }
+    }
+
+    /* Free the evicted element after the ring is back in shape */
+    if (r->free_func) {
+        r->free_func(old);
+    }
+    return TRUE;
+}
+
 gboolean
 gutil_ring_put(
     GUtilRing* r,
     gpointer data)
 {
-    if (gutil_ring_reserve(r, gutil_ring_size(r) + 1)) {
+    const gint size = gutil_ring_size(r);
+
+    if (G_LIKELY(r) && (r->flags & GUTIL_RING_FLAG_OVERWRITE) &&
+        r->maxsiz >= 0 && size >= r->maxsiz) {
+        return size > 0 && gutil_ring_overwrite(r, data);
+    } else if (gutil_ring_reserve(r, size + 1)) {
+        if (r->blocks) {
+            gutil_ring_blocks_put(r->blocks, data);
+            return TRUE;
+        }
         if (r->start < 0) {
             r->start = r->end = 0;
         }
@@ -299,11 +718,14 @@ gutil_ring_put_front(
     gpointer data)
 {
     if (gutil_ring_reserve(r, gutil_ring_size(r) + 1)) {
-        if (r->start >= 0) {
+        if (r->blocks) {
+            gutil_ring_blocks_put_front(r->blocks, data);
+            return TRUE;
+        } else if (r->start >= 0) {
             r->start = (r->start + r->alloc - 1) % r->alloc;
         } else {
             r->start = 0;
-            r->end = 1;
+            r->end = 1 % r->alloc;
         }
         r->data[r->start] = data;
         return TRUE;
@@ -315,7 +737,11 @@ gpointer
 gutil_ring_get(
     GUtilRing* r)
 {
-    if (G_LIKELY(r) && r->start >= 0) {
+    if (G_UNLIKELY(!r)) {
+        return NULL;
+    } else if (r->blocks) {
+        return r->blocks->count ? gutil_ring_blocks_get(r->blocks) : NULL;
+    } else if (r->start >= 0) {
         gpointer data = r->data[r->start++];
 
         if (r->start == r->end) {
@@ -335,7 +761,11 @@ gpointer
 gutil_ring_get_last(
     GUtilRing* r)
 {
-    if (G_LIKELY(r) && r->start >= 0) {
+    if (G_UNLIKELY(!r)) {
+        return NULL;
+    } else if (r->blocks) {
+        return r->blocks->count ? gutil_ring_blocks_get_last(r->blocks) : NULL;
+    } else if (r->start >= 0) {
         gpointer data;
 
         r->end = (r->end + r->alloc - 1) % r->alloc;
@@ -361,7 +791,20 @@ gutil_ring_drop(
             gutil_ring_clear(r);
         } else {
             dropped = n;
-            if (r->free_func) {
+            if (r->blocks) {
+                GUtilRingBlocks* b = r->blocks;
+
+                while ((n--) > 0) {
+                    gpointer data = *gutil_ring_block_slot(b, 0);
+
+                    b->first++;
+                    b->count--;
+                    if (r->free_func) {
+                        r->free_func(data);
+                    }
+                }
+                gutil_ring_blocks_trim(b);
+            } else if (r->free_func) {
                 while ((n--) > 0) {
                     r->free_func(r->data[r->start]);
                     r->start = (r->start + 1) % r->alloc;
@@ -389,7 +832,18 @@ gutil_ring_drop_last(
             gutil_ring_clear(r);
         } else {
             dropped = n;
-            if (r->free_func) {
+            if (r->blocks) {
+                GUtilRingBlocks* b = r->blocks;
+
+                while ((n--) > 0) {
+                    gpointer data = *gutil_ring_block_slot(b, --b->count);
+
+                    if (r->free_func) {
+                        r->free_func(data);
+                    }
+                }
+                gutil_ring_blocks_trim(b);
+            } else if (r->free_func) {
                 while ((n--) > 0) {
                     r->end = (r->end + r->alloc - 1) % r->alloc;
                     r->free_func(r->data[r->end]);
@@ -410,10 +864,42 @@ gutil_ring_data_at(
     gint pos)
 {
     if (pos >= 0 && pos < gutil_ring_size(r)) {
-        return r->data[(r->start + pos) % r->alloc];
+        return r->blocks ? *gutil_ring_block_slot(r->blocks, pos) :
+            r->data[(r->start + pos) % r->alloc];
     }
     return NULL;
+}
+
+static
+gpointer*
+gutil_ring_blocks_flatten(
+    GUtilRing* r,
+    gint n)
+{
+    GUtilRingBlocks* b = r->blocks;
 
+    if (b->first + n <= b->size) {
+        /* Everything is in the first block */
+        return gutil_ring_block(b, 0) + b->first;
+    } else {
+        /* Make a contiguous copy, the blocks stay where they are */
+        gint i, k = 0;
+
+        if (r->alloc < n) {
+            g_free(r->data);
+            r->data = g_new(gpointer, n);
+            r->alloc = n;
+        }
+        for (i = 0; k < n; i++) {
+            const gint off = i ? 0 : b->first;
+            const gint m = MIN(b->size - off, n - k);
+
+            memcpy(r->data + k, gutil_ring_block(b, i) + off,
+                sizeof(gpointer) * m);
+            k += m;
+        }
+        return r->data;
+    }
 }
 
 gpointer*
@@ -425,23 +911,88 @@ gutil_ring_flatten(
     const gint n = gutil_ring_size(r);
 
     if (G_LIKELY(r) && n > 0) {
-        if (r->start > 0 && r->start >= r->end) {
-            gpointer* buf = g_new(gpointer, n);
-            const gint n1 = r->alloc - r->start;
+        if (r->blocks) {
+            data = gutil_ring_blocks_flatten(r, n);
+        } else {
+            if (r->start > 0 && r->start >= r->end) {
+                gpointer* buf = g_new(gpointer, r->alloc);
+                const gint n1 = r->alloc - r->start;
 
-            memcpy(buf, r->data + r->start, sizeof(gpointer) * n1);
-            memcpy(buf + n1, r->data, sizeof(gpointer) * r->end);
-            g_free(r->data);
-            r->data = buf;
-            r->start = 0;
-            r->end = (n % r->alloc);
+                memcpy(buf, r->data + r->start, sizeof(gpointer) * n1);
+                memcpy(buf + n1, r->data, sizeof(gpointer) * r->end);
+                g_free(r->data);
+                r->data = buf;
+                r->start = 0;
+                r->end = (n % r->alloc);
+            }
+            data = r->data + r->start;
         }
-        data = r->data + r->start;
     }
     if (size) *size = n;
     return data;
 }
 
+void
+gutil_ring_foreach(
+    GUtilRing* r,
+    GFunc func,
+    gpointer user_data)
+{
+    if (G_LIKELY(r) && G_LIKELY(func)) {
+        gpointer* ptr;
+        gint i, n;
+
+        for (i = 0; (ptr = gutil_ring_segment(r, i, &n)) != NULL; i++) {
+            gpointer* end = ptr + n;
+
+            while (ptr < end) {
+                func(*ptr++, user_data);
+            }
+        }
+    }
+}
+
+void
+gutil_ring_iter_init(
+    GUtilRingIter* iter,
+    GUtilRing* r)
+{
+    if (G_LIKELY(iter)) {
+        iter->ring = r;
+        iter->ptr = iter->end = NULL;
+        iter->segment = 0;
+    }
+}
+
+gboolean
+gutil_ring_iter_next(
+    GUtilRingIter* iter,
+    gpointer* data)
+{
+    if (G_LIKELY(iter) && G_LIKELY(iter->ring)) {
+        if (iter->ptr == iter->end) {
+            gint n;
+            gpointer* ptr = gutil_ring_segment(iter->ring,
+                iter->segment, &n);
+
+            if (!ptr) {
+                /* No more data */
+                iter->ring = NULL;
+                return FALSE;
+            }
+            iter->segment++;
+            iter->ptr = ptr;
+            iter->end = ptr + n;
+        }
+        if (data) {
+            *data = *iter->ptr;
+        }
+        iter->ptr++;
+        return TRUE;
+    }
+    return FALSE;
+}
+
 /*
  * Local Variables:
  * mode: C
@@ -0,0 +1,432 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "gutil_rollup.h"
+#include "gutil_impl.h"
+#include "gutil_log.h"
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+#define GUTIL_ROLLUP_DEFAULT_TIME_FUNC g_get_monotonic_time
+#define GUTIL_ROLLUP_RAW_INTERVAL (60 * GUTIL_HISTORY_SEC)
+
+typedef struct gutil_rollup_sample {
+    gint64 time;
+    gint64 value;
+} GUtilRollupSample;
+
+typedef struct gutil_rollup_bucket {
+    gint64 slot;                        /* Timestamp divided by width */
+    GUtilRollupStats stats;
+} GUtilRollupBucket;
+
+typedef struct gutil_rollup_level {
+    gint64 width;                       /* Bucket width */
+    guint size;                         /* Number of buckets */
+    GUtilRollupBucket* bucket;
+} GUtilRollupLevel;
+
+/* From the finest to the coarsest */
+#define GUTIL_ROLLUP_LEVELS (2)
+static const gint64 gutil_rollup_width[GUTIL_ROLLUP_LEVELS] = {
+    GUTIL_HISTORY_SEC, 60 * GUTIL_HISTORY_SEC
+};
+
+struct gutil_rollup {
+    gint ref_count;
+    GUtilHistoryTimeFunc time;
+    gint64 last_time;                   /* Time never goes back */
+    gint64 raw_lost;                    /* The last sample pushed out */
+    guint raw_max;
+    guint raw_first;
+    guint raw_count;
+    GUtilRollupSample* raw;
+    GUtilRollupLevel level[GUTIL_ROLLUP_LEVELS];
+};
+
+typedef struct gutil_rollup_query {
+    GUtilRollup* r;
+    gint64 now;
+    gint64 cutoff;                      /* Inclusive */
+    gint64 raw_from;                    /* Raw samples are valid since */
+    GUtilRollupStats stats;
+} GUtilRollupQuery;
+
+static inline
+gint64
+gutil_rollup_align_up(
+    gint64 t,
+    gint64 width)
+{
+    return (gutil_div_floor(t - 1, width) + 1) * width;
+}
+
+static
+void
+gutil_rollup_stats_add(
+    GUtilRollupStats* stats,
+    gint64 value)
+{
+    if (stats->count) {
+        stats->count++;
+        stats->sum += value;
+        if (stats->min > value) {
+            stats->min = value;
+        }
+        if (stats->max < value) {
+            stats->max = value;
+        }
+    } else {
+        stats->count = 1;
+        stats->sum = stats->min = stats->max = value;
+    }
+}
+
+static
+void
+gutil_rollup_stats_merge(
+    GUtilRollupStats* stats,
+    const GUtilRollupStats* add)
+{
+    if (add->count) {
+        if (stats->count) {
+            stats->count += add->count;
+            stats->sum += add->sum;
+            stats->min = MIN(stats->min, add->min);
+            stats->max = MAX(stats->max, add->max);
+        } else {
+            *stats = *add;
+        }
+    }
+}
+
+static
+void
+gutil_rollup_merge_raw(
+    GUtilRollup* r,
+    gint64 from,
+    gint64 to,
+    GUtilRollupStats* stats)
+{
+    guint i;
+
+    /*
+     * Both are timestamps, from is inclusive, to is exclusive. Samples
+     * are sorted by time, walk them from the newest one and stop as
+     * soon as we get past the lower boundary.
+     */
+    for (i = r->raw_count; i > 0; i--) {
+        const GUtilRollupSample* s = r->raw +
+            (r->raw_first + i - 1) % r->raw_max;
+
+        if (s->time < from) {
+            break;
+        } else if (s->time < to) {
+            gutil_rollup_stats_add(stats, s->value);
+        }
+    }
+}
+
+static
+void
+gutil_rollup_merge_level(
+    GUtilRollupLevel* level,
+    gint64 lo,
+    gint64 hi,
+    GUtilRollupStats* stats)
+{
+    gint64 slot;
+
+    /* Both are slots, inclusive */
+    for (slot = lo; slot <= hi; slot++) {
+        const gint64 size = level->size;
+        const GUtilRollupBucket* b = level->bucket +
+            ((slot % size) + size) % size;
+
+        if (b->slot == slot) {
+            gutil_rollup_stats_merge(stats, &b->stats);
+        }
+    }
+}
+
+static
+void
+gutil_rollup_reset(
+    GUtilRollup* r)
+{
+    int i;
+
+    r->last_time = r->raw_lost = G_MININT64;
+    r->raw_first = r->raw_count = 0;
+    for (i = 0; i < GUTIL_ROLLUP_LEVELS; i++) {
+        GUtilRollupLevel* level = r->level + i;
+
+        memset(level->bucket, 0, sizeof(level->bucket[0]) * level->size);
+    }
+}
+
+GUtilRollup*
+gutil_rollup_new(
+    guint max_samples,
+    guint seconds,
+    guint minutes)
+{
+    return gutil_rollup_new_full(max_samples, seconds, minutes, NULL);
+}
+
+GUtilRollup*
+gutil_rollup_new_full(
+    guint max_samples,
+    guint seconds,
+    guint minutes,
+    GUtilHistoryTimeFunc fn)
+{
+    if (max_samples && seconds && minutes) {
+        /* The whole thing is allocated from a single memory block */
+        GUtilRollup* r = g_malloc0(sizeof(GUtilRollup) +
+            max_samples * sizeof(GUtilRollupSample) +
+            (seconds + minutes) * sizeof(GUtilRollupBucket));
+        GUtilRollupBucket* bucket;
+
+        g_atomic_int_set(&r->ref_count, 1);
+        r->time = fn ? fn : GUTIL_ROLLUP_DEFAULT_TIME_FUNC;
+        r->raw = (GUtilRollupSample*)(r + 1);
+        r->raw_max = max_samples;
+        bucket = (GUtilRollupBucket*)(r->raw + max_samples);
+        r->level[0].width = gutil_rollup_width[0];
+        r->level[0].size = seconds;
+        r->level[0].bucket = bucket;
+        r->level[1].width = gutil_rollup_width[1];
+        r->level[1].size = minutes;
+        r->level[1].bucket = bucket + seconds;
+        gutil_rollup_reset(r);
+        return r;
+    }
+    return NULL;
+}
+
+GUtilRollup*
+gutil_rollup_ref(
+    GUtilRollup* r)
+{
+    if (G_LIKELY(r)) {
+        GASSERT(r->ref_count > 0);
+        g_atomic_int_inc(&r->ref_count);
+    }
+    return r;
+}
+
+void
+gutil_rollup_unref(
+    GUtilRollup* r)
+{
+    if (G_LIKELY(r)) {
+        GASSERT(r->ref_count > 0);
+        if (g_atomic_int_dec_and_test(&r->ref_count)) {
+            g_free(r);
+        }
+    }
+}
+
+void
+gutil_rollup_clear(
+    GUtilRollup* r)
+{
+    if (G_LIKELY(r)) {
+        gutil_rollup_reset(r);
+    }
+}
+
+void
+gutil_rollup_add(
+    GUtilRollup* r,
+    gint64 value)
+{
+    if (G_LIKELY(r)) {
+        const gint64 now = MAX(r->time(), r->last_time);
+        GUtilRollupSample* s;
+        int i;
+
+        r->last_time = now;
+        if (r->raw_count == r->raw_max) {
+            /* The raw samples don't cover the whole minute anymore */
+            r->raw_lost = r->raw[r->raw_first].time;
+            r->raw_first = (r->raw_first + 1) % r->raw_max;
+            r->raw_count--;
+        }
+        s = r->raw + (r->raw_first + r->raw_count) % r->raw_max;
+        s->time = now;
+        s->value = value;
+        r->raw_count++;
+
+        for (i = 0; i < GUTIL_ROLLUP_LEVELS; i++) {
+            GUtilRollupLevel* level = r->level + i;
+            const gint64 slot = gutil_div_floor(now, level->width);
+            GUtilRollupBucket* b = level->bucket + (guint)
+                (((slot % level->size) + level->size) % level->size);
+
+            if (b->slot != slot) {
+                /* This bucket has been sitting there for too long */
+                b->slot = slot;
+                b->stats.count = 0;
+            }
+            gutil_rollup_stats_add(&b->stats, value);
+        }
+    }
+}
+
+static
+gint64
+gutil_rollup_query_width(
+    const GUtilRollupQuery* q,
+    int k)
+{
+    /* Source 0 is the raw samples, the rest are the levels */
+    return k ? q->r->level[k - 1].width : 1;
+}
+
+static
+gint64
+gutil_rollup_query_start(
+    const GUtilRollupQuery* q,
+    int k)
+{
+    if (k) {
+        const GUtilRollupLevel* level = q->r->level + (k - 1);
+
+        return (gutil_div_floor(q->now, level->width) - level->size + 1) *
+            level->width;
+    } else {
+        return q->raw_from;
+    }
+}
+
+static
+void
+gutil_rollup_query_merge(
+    GUtilRollupQuery* q,
+    int k,
+    gint64 from,
+    gint64 to)
+{
+    if (k) {
+        GUtilRollupLevel* level = q->r->level + (k - 1);
+
+        gutil_rollup_merge_level(level, gutil_div_floor(from, level->width),
+            gutil_div_floor(to - 1, level->width), &q->stats);
+    } else {
+        gutil_rollup_merge_raw(q->r, from, to, &q->stats);
+    }
+}
+
+static
+gboolean
+gutil_rollup_query_plan(
+    GUtilRollupQuery* q,
+    int k,
+    gint64 to)
+{
+    const gint64 start = gutil_rollup_query_start(q, k);
+    int j;
+
+    /*
+     * Source k covers [start, to) and the part before that needs to be
+     * taken from a coarser source j. The boundary has to be aligned with
+     * the buckets of j, otherwise the bucket containing the boundary would
+     * count some samples twice. If source k can't hand over to anything
+     * below the upper boundary, it's not used at all and the caller has
+     * to hand over to a coarser source itself.
+     */
+    if (q->cutoff >= start) {
+        gutil_rollup_query_merge(q, k, q->cutoff, to);
+        return TRUE;
+    } else if (k == GUTIL_ROLLUP_LEVELS) {
+        /* Anything older than that is gone */
+        gutil_rollup_query_merge(q, k, start, to);
+        return TRUE;
+    }
+    for (j = k + 1; j <= GUTIL_ROLLUP_LEVELS; j++) {
+        const gint64 from = gutil_rollup_align_up(start,
+            gutil_rollup_query_width(q, j));
+
+        if (from >= to) {
+            /* Coarser sources would have even higher boundaries */
+            break;
+        } else if (gutil_rollup_query_plan(q, j, from)) {
+            gutil_rollup_query_merge(q, k, from, to);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+gboolean
+gutil_rollup_stats(
+    GUtilRollup* r,
+    gint64 interval,
+    GUtilRollupStats* out)
+{
+    GUtilRollupQuery q;
+
+    memset(&q, 0, sizeof(q));
+    if (G_LIKELY(r) && r->raw_count) {
+        int k;
+
+        q.r = r;
+        q.now = MAX(r->time(), r->last_time);
+        q.cutoff = (interval <= 0) ? q.now :
+            (q.now > G_MININT64 + interval) ? (q.now - interval) :
+            G_MININT64;
+        q.raw_from = MAX(q.now - GUTIL_ROLLUP_RAW_INTERVAL, r->raw_lost + 1);
+
+        /*
+         * Use the finest resolution available for each part of the
+         * interval. The last (coarsest) level always succeeds.
+         */
+        for (k = 0; !gutil_rollup_query_plan(&q, k, q.now + 1); k++) {
+            GASSERT(k < GUTIL_ROLLUP_LEVELS);
+        }
+    }
+    if (out) {
+        *out = q.stats;
+    }
+    return q.stats.count > 0;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Tag index template, included by the implementation files which keep
+ * tagged items (GUtilIdleQueue callbacks, GUtilTimerWheel timers).
+ *
+ * Items with the same tag form a circular doubly linked list, the first
+ * (oldest) of which is stored in the index. That makes tag lookups and
+ * cancellation O(1). Untagged items are the most common case, so the
+ * first of them is stored separately, without touching the hash table.
+ *
+ * When the last item with a tag goes away, its hash table entry is kept
+ * (with NULL value), so that the table doesn't shrink when the owner is
+ * drained and grow again when it's refilled. The empty entries are
+ * pruned when there are more of them than the most tags ever in use at
+ * the same time, i.e. when the tags don't recur.
+ *
+ * The includer defines:
+ *
+ *   GUTIL_TAGS_ITEM   type of the items, having tag, tag_next and
+ *                     tag_prev fields
+ *   GUTIL_TAGS_TAG    type of the tags
+ *   GUTIL_TAGS_FN(x)  name of the function x
+ *
+ * All of these are undefined at the end of this file.
+ */
+
+#ifndef GUTIL_TAGS_IMPL_H
+#define GUTIL_TAGS_IMPL_H
+
+typedef struct gutil_tag_index {
+    gpointer untagged;                  /* The first untagged item */
+    GHashTable* tags;                   /* The first item per tag */
+    guint used;                         /* Entries with non-NULL value */
+    guint max_used;
+    guint empty;                        /* Entries with NULL value */
+} GUtilTagIndex;
+
+static
+gboolean
+gutil_tag_index_empty(
+    gpointer key,
+    gpointer value,
+    gpointer user_data)
+{
+    return !value;
+}
+
+static
+void
+gutil_tag_index_clear(
+    GUtilTagIndex* index)
+{
+    if (index->tags) {
+        g_hash_table_destroy(index->tags);
+    }
+    memset(index, 0, sizeof(*index));
+}
+
+#endif /* GUTIL_TAGS_IMPL_H */
+
+static
+GUTIL_TAGS_ITEM*
+GUTIL_TAGS_FN(find_tag)(
+    GUtilTagIndex* index,
+    GUTIL_TAGS_TAG tag)
+{
+    if (!tag) {
+        return index->untagged;
+    } else if (index->tags) {
+        return g_hash_table_lookup(index->tags, GSIZE_TO_POINTER(tag));
+    } else {
+        return NULL;
+    }
+}
+
+static
+void
+GUTIL_TAGS_FN(tag_index_set)(
+    GUtilTagIndex* index,
+    GUTIL_TAGS_TAG tag,
+    GUTIL_TAGS_ITEM* first)
+{
+    /* Replaces the first item of the existing list */
+    if (!tag) {
+        index->untagged = first;
+    } else {
+        g_hash_table_insert(index->tags, GSIZE_TO_POINTER(tag), first);
+    }
+}
+
+static
+void
+GUTIL_TAGS_FN(tag_index_add)(
+    GUtilTagIndex* index,
+    GUTIL_TAGS_TAG tag,
+    GUTIL_TAGS_ITEM* first)
+{
+    if (!tag) {
+        index->untagged = first;
+    } else {
+        gpointer key = GSIZE_TO_POINTER(tag);
+
+        if (!index->tags) {
+            index->tags = g_hash_table_new(g_direct_hash, g_direct_equal);
+        } else if (index->empty && g_hash_table_lookup_extended(index->tags,
+            key, NULL, NULL)) {
+            /* Reusing the empty entry */
+            index->empty--;
+        }
+        if (++index->used > index->max_used) {
+            index->max_used = index->used;
+        }
+        g_hash_table_insert(index->tags, key, first);
+    }
+}
+
+static
+void
+GUTIL_TAGS_FN(tag_index_remove)(
+    GUtilTagIndex* index,
+    GUTIL_TAGS_TAG tag)
+{
+    if (!tag) {
+        index->untagged = NULL;
+    } else {
+        gpointer key = GSIZE_TO_POINTER(tag);
+
+        index->used--;
+        if (++index->empty > index->max_used) {
+            g_hash_table_foreach_remove(index->tags,
+                gutil_tag_index_empty, NULL);
+            g_hash_table_remove(index->tags, key);
+            index->empty = 0;
+        } else {
+            /* Replacing the value doesn't touch the table's storage */
+            g_hash_table_insert(index->tags, key, NULL);
+        }
+    }
+}
+
+static
+void
+GUTIL_TAGS_FN(tag_link)(
+    GUtilTagIndex* index,
+    GUTIL_TAGS_ITEM* item)
+{
+    GUTIL_TAGS_ITEM* head = GUTIL_TAGS_FN(find_tag)(index, item->tag);
+
+    if (head) {
+        item->tag_next = head;
+        item->tag_prev = head->tag_prev;
+        head->tag_prev->tag_next = item;
+        head->tag_prev = item;
+    } else {
+        item->tag_next = item->tag_prev = item;
+        GUTIL_TAGS_FN(tag_index_add)(index, item->tag, item);
+    }
+}
+
+static
+void
+GUTIL_TAGS_FN(tag_unlink)(
+    GUtilTagIndex* index,
+    GUTIL_TAGS_ITEM* item)
+{
+    if (item->tag_next == item) {
+        GUTIL_TAGS_FN(tag_index_remove)(index, item->tag);
+    } else {
+        item->tag_next->tag_prev = item->tag_prev;
+        item->tag_prev->tag_next = item->tag_next;
+        if (GUTIL_TAGS_FN(find_tag)(index, item->tag) == item) {
+            GUTIL_TAGS_FN(tag_index_set)(index, item->tag, item->tag_next);
+        }
+    }
+    item->tag_next = item->tag_prev = NULL;
+}
+
+#undef GUTIL_TAGS_ITEM
+#undef GUTIL_TAGS_TAG
+#undef GUTIL_TAGS_FN
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
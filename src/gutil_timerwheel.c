@@ -0,0 +1,560 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "gutil_timerwheel.h"
+#include "gutil_impl.h"
+#include "gutil_macros.h"
+#include "gutil_log.h"
+
+#if __GNUC__ >= 4
+#pragma GCC visibility push(default)
+#endif
+
+/*
+ * The wheel has GUTIL_TIMER_WHEEL_LEVELS levels of 64 slots each. The
+ * slots of level 0 are one tick wide, each slot of the next level is
+ * 64 times wider than the slots of the previous one. A timer goes to
+ * the lowest level which covers its expiration time, and to the slot
+ * corresponding to that time. When the current tick reaches the start
+ * of a higher level slot, the timers in that slot are cascaded to the
+ * lower levels. Timers due later than the wheel covers are placed into
+ * the farthest top level slot and get re-inserted when it's cascaded.
+ *
+ * Each level has a bitmap of occupied slots, which allows to find the
+ * next tick when something has to be done (either a level 0 slot is
+ * due or a higher level slot needs to be cascaded) without scanning
+ * the slots. Ticks without anything to do are skipped.
+ *
+ * Timers are linked into doubly linked lists (slots and the list of
+ * due timers being invoked), and indexed by tag (see gutil_tags_impl.h).
+ */
+
+#define GUTIL_TIMER_WHEEL_BITS (6)
+#define GUTIL_TIMER_WHEEL_SLOTS (1 << GUTIL_TIMER_WHEEL_BITS)
+#define GUTIL_TIMER_WHEEL_MASK (GUTIL_TIMER_WHEEL_SLOTS - 1)
+#define GUTIL_TIMER_WHEEL_LEVELS (5)
+#define GUTIL_TIMER_WHEEL_MAX ((G_GINT64_CONSTANT(1) << \
+    (GUTIL_TIMER_WHEEL_BITS * GUTIL_TIMER_WHEEL_LEVELS)) - 1)
+
+typedef struct gutil_timer_wheel_item GUtilTimerWheelItem;
+
+typedef struct gutil_timer_wheel_list {
+    GUtilTimerWheelItem* first;
+    GUtilTimerWheelItem* last;
+} GUtilTimerWheelList;
+
+struct gutil_timer_wheel_item {
+    GUtilTimerWheelItem* next;
+    GUtilTimerWheelItem* prev;
+    GUtilTimerWheelItem* tag_next;      /* Circular list of same tag */
+    GUtilTimerWheelItem* tag_prev;
+    GUtilTimerWheelList* list;          /* Slot or the due list */
+    GUtilTimerWheelTag tag;
+    gint64 expires;                     /* In ticks */
+    GUtilTimerFunc run;
+    gpointer data;
+    GFreeFunc destroy;
+};
+
+#define GUTIL_TAGS_ITEM GUtilTimerWheelItem
+#define GUTIL_TAGS_TAG GUtilTimerWheelTag
+#define GUTIL_TAGS_FN(x) gutil_timer_wheel_##x
+#include "gutil_tags_impl.h"
+
+typedef struct gutil_timer_wheel_source {
+    GSource source;
+    GUtilTimerWheel* wheel;
+} GUtilTimerWheelSource;
+
+struct gutil_timer_wheel {
+    gint ref_count;
+    guint count;
+    gint64 start;                       /* Monotonic time of tick zero */
+    gint64 tick;                        /* Microseconds */
+    gint64 now;                         /* The last processed tick */
+    GSource* source;                    /* Created on demand */
+    GUtilTagIndex tags;
+    GUtilTimerWheelList due;            /* Being invoked */
+    guint64 occupied[GUTIL_TIMER_WHEEL_LEVELS];
+    GUtilTimerWheelList slot[GUTIL_TIMER_WHEEL_LEVELS]
+        [GUTIL_TIMER_WHEEL_SLOTS];
+};
+
+static
+void
+gutil_timer_wheel_list_append(
+    GUtilTimerWheelList* list,
+    GUtilTimerWheelItem* item)
+{
+    item->list = list;
+    item->next = NULL;
+    item->prev = list->last;
+    if (list->last) {
+        list->last->next = item;
+    } else {
+        list->first = item;
+    }
+    list->last = item;
+}
+
+static
+void
+gutil_timer_wheel_list_remove(
+    GUtilTimerWheel* w,
+    GUtilTimerWheelItem* item)
+{
+    GUtilTimerWheelList* list = item->list;
+
+    if (item->prev) {
+        item->prev->next = item->next;
+    } else {
+        GASSERT(list->first == item);
+        list->first = item->next;
+    }
+    if (item->next) {
+        item->next->prev = item->prev;
+    } else {
+        GASSERT(list->last == item);
+        list->last = item->prev;
+    }
+    item->next = item->prev = NULL;
+    item->list = NULL;
+
+    /* Update the bitmap if the slot has become empty */
+    if (!list->first && list != &w->due) {
+        const guint index = list - w->slot[0];
+
+        w->occupied[index / GUTIL_TIMER_WHEEL_SLOTS] &=
+            ~(G_GUINT64_CONSTANT(1) << (index % GUTIL_TIMER_WHEEL_SLOTS));
+    }
+}
+
+static
+void
+gutil_timer_wheel_insert(
+    GUtilTimerWheel* w,
+    GUtilTimerWheelItem* item)
+{
+    const gint64 delta = MIN(item->expires - w->now, GUTIL_TIMER_WHEEL_MAX);
+    const gint64 expires = w->now + delta;
+    guint level = 0;
+    guint slot;
+
+    /* The lowest level which covers the expiration time */
+    while (level < (GUTIL_TIMER_WHEEL_LEVELS - 1) && delta >=
+        (G_GINT64_CONSTANT(1) << (GUTIL_TIMER_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    slot = (guint)(expires >> (GUTIL_TIMER_WHEEL_BITS * level)) &
+        GUTIL_TIMER_WHEEL_MASK;
+    gutil_timer_wheel_list_append(w->slot[level] + slot, item);
+    w->occupied[level] |= G_GUINT64_CONSTANT(1) << slot;
+}
+
+static inline
+guint
+gutil_timer_wheel_distance(
+    guint64 bits,
+    guint from)
+{
+    /* Distance from the slot to the next occupied one (bits != 0) */
+    const guint64 x = from ? ((bits >> from) |
+        (bits << (GUTIL_TIMER_WHEEL_SLOTS - from))) : bits;
+    const guint32 lo = (guint32)x;
+
+    return lo ? g_bit_nth_lsf(lo, -1) :
+        (32 + g_bit_nth_lsf((guint32)(x >> 32), -1));
+}
+
+static
+gboolean
+gutil_timer_wheel_next(
+    GUtilTimerWheel* w,
+    gint64* next)
+{
+    gboolean found = FALSE;
+    guint level;
+
+    /*
+     * The next occupied level 0 slot is due at its tick, and the next
+     * occupied higher level slot needs to be cascaded at its start.
+     */
+    for (level = 0; level < GUTIL_TIMER_WHEEL_LEVELS; level++) {
+        const guint64 bits = w->occupied[level];
+
+        if (bits) {
+            const guint shift = GUTIL_TIMER_WHEEL_BITS * level;
+            const gint64 cur = w->now >> shift;
+            const gint64 tick = (cur + 1 + gutil_timer_wheel_distance(bits,
+                (guint)(cur + 1) & GUTIL_TIMER_WHEEL_MASK)) << shift;
+
+            if (!found || *next > tick) {
+                *next = tick;
+                found = TRUE;
+            }
+        }
+    }
+    return found;
+}
+
+static
+void
+gutil_timer_wheel_cascade(
+    GUtilTimerWheel* w,
+    guint level,
+    guint slot)
+{
+    GUtilTimerWheelList* list = w->slot[level] + slot;
+    GUtilTimerWheelItem* item;
+
+    while ((item = list->first) != NULL) {
+        gutil_timer_wheel_list_remove(w, item);
+        gutil_timer_wheel_insert(w, item);
+    }
+}
+
+static
+void
+gutil_timer_wheel_advance(
+    GUtilTimerWheel* w,
+    gint64 now)
+{
+    gint64 next;
+
+    while (w->now < now && gutil_timer_wheel_next(w, &next) && next <= now) {
+        GUtilTimerWheelList* list;
+        GUtilTimerWheelItem* item;
+        guint level;
+
+        /* Cascade the higher levels which have reached the slot start */
+        w->now = next;
+        for (level = GUTIL_TIMER_WHEEL_LEVELS - 1; level > 0; level--) {
+            const guint shift = GUTIL_TIMER_WHEEL_BITS * level;
+
+            if (!(next & ((G_GINT64_CONSTANT(1) << shift) - 1))) {
+                gutil_timer_wheel_cascade(w, level, (guint)(next >> shift) &
+                    GUTIL_TIMER_WHEEL_MASK);
+            }
+        }
+
+        /* And move the expired timers to the due list */
+        list = w->slot[0] + (next & GUTIL_TIMER_WHEEL_MASK);
+        while ((item = list->first) != NULL) {
+            GASSERT(item->expires == next);
+            gutil_timer_wheel_list_remove(w, item);
+            gutil_timer_wheel_list_append(&w->due, item);
+        }
+    }
+
+    /* Nothing happens in between */
+    if (w->now < now) {
+        w->now = now;
+    }
+}
+
+static
+void
+gutil_timer_wheel_item_free(
+    GUtilTimerWheelItem* item)
+{
+    if (item->destroy) {
+        item->destroy(item->data);
+    }
+    gutil_slice_free(item);
+}
+
+static
+void
+gutil_timer_wheel_cancel_item(
+    GUtilTimerWheel* w,
+    GUtilTimerWheelItem* item)
+{
+    gutil_timer_wheel_list_remove(w, item);
+    gutil_timer_wheel_tag_unlink(&w->tags, item);
+    w->count--;
+    gutil_timer_wheel_item_free(item);
+}
+
+static
+gint64
+gutil_timer_wheel_current_tick(
+    GUtilTimerWheel* w,
+    gint64 time)
+{
+    return (time - w->start) / w->tick;
+}
+
+static
+gboolean
+gutil_timer_wheel_source_prepare(
+    GSource* source,
+    gint* timeout)
+{
+    GUtilTimerWheel* w = ((GUtilTimerWheelSource*)source)->wheel;
+    gint64 next;
+
+    *timeout = -1;
+    if (gutil_timer_wheel_next(w, &next)) {
+        const gint64 now = g_source_get_time(source);
+        const gint64 deadline = w->start + next * w->tick;
+
+        if (deadline <= now) {
+            return TRUE;
+        } else {
+            *timeout = gutil_timeout_ms(deadline - now);
+        }
+    }
+    return FALSE;
+}
+
+static
+gboolean
+gutil_timer_wheel_source_check(
+    GSource* source)
+{
+    GUtilTimerWheel* w = ((GUtilTimerWheelSource*)source)->wheel;
+    gint64 next;
+
+    return gutil_timer_wheel_next(w, &next) &&
+        next <= gutil_timer_wheel_current_tick(w, g_source_get_time(source));
+}
+
+static
+gboolean
+gutil_timer_wheel_source_dispatch(
+    GSource* source,
+    GSourceFunc callback,
+    gpointer user_data)
+{
+    GUtilTimerWheel* w = ((GUtilTimerWheelSource*)source)->wheel;
+    GUtilTimerWheelItem* item;
+
+    /* Callbacks may drop the last reference */
+    gutil_timer_wheel_ref(w);
+    gutil_timer_wheel_advance(w, gutil_timer_wheel_current_tick(w,
+        g_source_get_time(source)));
+
+    /*
+     * Callbacks may cancel the due timers too. If one of them drops the
+     * last reference, the rest gets cancelled by gutil_timer_wheel_unref().
+     */
+    while ((item = w->due.first) != NULL &&
+        g_atomic_int_get(&w->ref_count) > 1) {
+        gutil_timer_wheel_list_remove(w, item);
+        gutil_timer_wheel_tag_unlink(&w->tags, item);
+        w->count--;
+        if (item->run) {
+            item->run(item->data);
+        }
+        gutil_timer_wheel_item_free(item);
+    }
+    gutil_timer_wheel_unref(w);
+    return G_SOURCE_CONTINUE;
+}
+
+static
+void
+gutil_timer_wheel_source_attach(
+    GUtilTimerWheel* w)
+{
+    static GSourceFuncs gutil_timer_wheel_source_funcs = {
+        gutil_timer_wheel_source_prepare,
+        gutil_timer_wheel_source_check,
+        gutil_timer_wheel_source_dispatch,
+        NULL
+    };
+
+    w->source = g_source_new(&gutil_timer_wheel_source_funcs,
+        sizeof(GUtilTimerWheelSource));
+    ((GUtilTimerWheelSource*)w->source)->wheel = w;
+    g_source_attach(w->source, g_main_context_default());
+}
+
+GUtilTimerWheel*
+gutil_timer_wheel_new(
+    guint tick_ms)
+{
+    GUtilTimerWheel* w = g_slice_new0(GUtilTimerWheel);
+
+    g_atomic_int_set(&w->ref_count, 1);
+    w->tick = (gint64)MAX(tick_ms, 1) * 1000;
+    w->start = g_get_monotonic_time();
+    return w;
+}
+
+GUtilTimerWheel*
+gutil_timer_wheel_ref(
+    GUtilTimerWheel* w)
+{
+    if (G_LIKELY(w)) {
+        GASSERT(w->ref_count > 0);
+        g_atomic_int_inc(&w->ref_count);
+    }
+    return w;
+}
+
+void
+gutil_timer_wheel_unref(
+    GUtilTimerWheel* w)
+{
+    if (G_LIKELY(w)) {
+        GASSERT(w->ref_count > 0);
+        if (g_atomic_int_dec_and_test(&w->ref_count)) {
+            if (w->source) {
+                g_source_destroy(w->source);
+                g_source_unref(w->source);
+                w->source = NULL;
+            }
+            gutil_timer_wheel_cancel_all(w);
+            gutil_tag_index_clear(&w->tags);
+            gutil_slice_free(w);
+        }
+    }
+}
+
+void
+gutil_timer_wheel_add(
+    GUtilTimerWheel* w,
+    guint timeout_ms,
+    GUtilTimerWheelTag tag,
+    GUtilTimerFunc run,
+    gpointer data,
+    GFreeFunc destroy)
+{
+    if (G_LIKELY(w)) {
+        GUtilTimerWheelItem* item = g_slice_new0(GUtilTimerWheelItem);
+        const gint64 now = g_get_monotonic_time() - w->start;
+
+        /* Don't let an empty wheel lag behind */
+        if (!w->count) {
+            w->now = MAX(w->now, now / w->tick);
+        }
+
+        /* Round the expiration time up to the tick */
+        item->tag = tag;
+        item->run = run;
+        item->data = data;
+        item->destroy = destroy;
+        item->expires = MAX((now + (gint64)timeout_ms * 1000 + w->tick - 1) /
+            w->tick, w->now + 1);
+        gutil_timer_wheel_insert(w, item);
+        gutil_timer_wheel_tag_link(&w->tags, item);
+        w->count++;
+
+        /* The source picks up the new timer when it polls */
+        if (!w->source) {
+            gutil_timer_wheel_source_attach(w);
+        }
+    } else if (destroy) {
+        destroy(data);
+    }
+}
+
+guint
+gutil_timer_wheel_count(
+    GUtilTimerWheel* w)
+{
+    return G_LIKELY(w) ? w->count : 0;
+}
+
+gboolean
+gutil_timer_wheel_contains_tag(
+    GUtilTimerWheel* w,
+    GUtilTimerWheelTag tag)
+{
+    return G_LIKELY(w) && gutil_timer_wheel_find_tag(&w->tags, tag);
+}
+
+gboolean
+gutil_timer_wheel_cancel_tag(
+    GUtilTimerWheel* w,
+    GUtilTimerWheelTag tag)
+{
+    if (G_LIKELY(w)) {
+        GUtilTimerWheelItem* item = gutil_timer_wheel_find_tag(&w->tags, tag);
+
+        if (item) {
+            gutil_timer_wheel_cancel_item(w, item);
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+void
+gutil_timer_wheel_cancel_all(
+    GUtilTimerWheel* w)
+{
+    if (G_LIKELY(w) && w->count) {
+        GUtilTimerWheelList cancelled;
+        GUtilTimerWheelItem* item;
+        guint level, slot;
+
+        /*
+         * Unlink everything first, destroy callbacks may add new timers
+         * and those are not cancelled.
+         */
+        memset(&cancelled, 0, sizeof(cancelled));
+        while ((item = w->due.first) != NULL) {
+            gutil_timer_wheel_list_remove(w, item);
+            gutil_timer_wheel_list_append(&cancelled, item);
+        }
+        for (level = 0; level < GUTIL_TIMER_WHEEL_LEVELS; level++) {
+            for (slot = 0; w->occupied[level]; slot++) {
+                GUtilTimerWheelList* list = w->slot[level] + slot;
+
+                while ((item = list->first) != NULL) {
+                    gutil_timer_wheel_list_remove(w, item);
+                    gutil_timer_wheel_list_append(&cancelled, item);
+                }
+            }
+        }
+        for (item = cancelled.first; item; item = item->next) {
+            gutil_timer_wheel_tag_unlink(&w->tags, item);
+        }
+        w->count = 0;
+
+        /* Then destroy them */
+        while ((item = cancelled.first) != NULL) {
+            cancelled.first = item->next;
+            gutil_timer_wheel_item_free(item);
+        }
+    }
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
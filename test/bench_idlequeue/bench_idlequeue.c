@@ -0,0 +1,518 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * GUtilIdleQueue benchmarks, driving a real GMainLoop. Every benchmark
+ * is run against every queue configuration listed in bench_idlequeue_types,
+ * so that's the only place to touch when a new configuration needs to
+ * be measured.
+ *
+ * With glibc, memory allocations are counted by wrapping malloc() and
+ * friends, and reported per operation (GSlice is switched to malloc
+ * for that). That's useful for validating the item pooling.
+ *
+ * Usage: bench_idlequeue [-n COUNT] [-r REPEAT] [BENCHMARK|VARIANT...]
+ */
+
+#include "gutil_idlequeue.h"
+
+#include <stdlib.h>
+
+#define BENCH_DEFAULT_COUNT (1000000)
+#define BENCH_DEFAULT_REPEAT (3)
+#define BENCH_CHAIN_DEPTH (64)
+#define BENCH_UNIQUE_TAGS (256)
+#define BENCH_BUDGET_ITEMS (64)
+#define BENCH_REFILL_DEPTH (256)
+
+typedef struct bench_idlequeue_type {
+    const char* name;
+    void (*setup)(GUtilIdleQueue* q);
+} BenchIdleQueueType;
+
+typedef struct bench_idlequeue {
+    const char* name;
+    /* Returns the number of operations performed */
+    guint (*run)(GUtilIdleQueue* q, guint count);
+} BenchIdleQueue;
+
+typedef struct bench_idlequeue_loop {
+    GMainLoop* loop;
+    GUtilIdleQueue* q;
+    guint remaining;                    /* Callbacks to run */
+    guint to_add;                       /* Chained callbacks to add */
+} BenchIdleQueueLoop;
+
+/* Prevents the compiler from optimizing the loops away */
+static volatile gsize bench_sink;
+
+/*==========================================================================*
+ * Allocation counter
+ *==========================================================================*/
+
+#ifdef __GLIBC__
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+static gsize bench_allocs;
+
+void*
+malloc(
+    size_t size)
+{
+    bench_allocs++;
+    return __libc_malloc(size);
+}
+
+void*
+calloc(
+    size_t n,
+    size_t size)
+{
+    bench_allocs++;
+    return __libc_calloc(n, size);
+}
+
+void*
+realloc(
+    void* ptr,
+    size_t size)
+{
+    /* Growing the block isn't a new allocation */
+    if (!ptr) {
+        bench_allocs++;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+#  define BENCH_ALLOCS() (bench_allocs)
+#else
+#  define BENCH_ALLOCS() (0)
+#endif
+
+/*==========================================================================*
+ * Variants
+ *==========================================================================*/
+
+static
+void
+bench_idlequeue_default_setup(
+    GUtilIdleQueue* q)
+{
+}
+
+static
+void
+bench_idlequeue_budget_setup(
+    GUtilIdleQueue* q)
+{
+    gutil_idle_queue_set_budget(q, BENCH_BUDGET_ITEMS, 0);
+}
+
+static
+void
+bench_idlequeue_stats_setup(
+    GUtilIdleQueue* q)
+{
+    gutil_idle_queue_set_stats_enabled(q, TRUE);
+}
+
+static const BenchIdleQueueType bench_idlequeue_types[] = {
+    { "default", bench_idlequeue_default_setup },
+    { "budget", bench_idlequeue_budget_setup },
+    { "stats", bench_idlequeue_stats_setup }
+};
+
+/*==========================================================================*
+ * Callbacks
+ *==========================================================================*/
+
+static
+void
+bench_idlequeue_done(
+    gpointer data)
+{
+    BenchIdleQueueLoop* bench = data;
+
+    if (!--bench->remaining) {
+        g_main_loop_quit(bench->loop);
+    }
+}
+
+static
+void
+bench_idlequeue_chain(
+    gpointer data)
+{
+    BenchIdleQueueLoop* bench = data;
+
+    /* Each callback enqueues the next one until we are done */
+    if (bench->to_add) {
+        bench->to_add--;
+        gutil_idle_queue_add(bench->q, bench_idlequeue_chain, bench);
+    }
+    bench_idlequeue_done(data);
+}
+
+static
+void
+bench_idlequeue_loop_init(
+    BenchIdleQueueLoop* bench,
+    GUtilIdleQueue* q,
+    guint remaining)
+{
+    memset(bench, 0, sizeof(*bench));
+    bench->loop = g_main_loop_new(NULL, FALSE);
+    bench->q = q;
+    bench->remaining = remaining;
+}
+
+static
+void
+bench_idlequeue_loop_run(
+    BenchIdleQueueLoop* bench)
+{
+    if (bench->remaining) {
+        g_main_loop_run(bench->loop);
+    }
+    g_main_loop_unref(bench->loop);
+}
+
+/*==========================================================================*
+ * Benchmarks
+ *==========================================================================*/
+
+static
+guint
+bench_idlequeue_add_run(
+    GUtilIdleQueue* q,
+    guint count)
+{
+    /* Untagged callbacks, queued upfront */
+    BenchIdleQueueLoop bench;
+    guint i;
+
+    bench_idlequeue_loop_init(&bench, q, count);
+    for (i = 0; i < count; i++) {
+        gutil_idle_queue_add(q, bench_idlequeue_done, &bench);
+    }
+    bench_idlequeue_loop_run(&bench);
+    return count;
+}
+
+static
+guint
+bench_idlequeue_add_run_tagged(
+    GUtilIdleQueue* q,
+    guint count)
+{
+    /* Same as above, each callback has its own tag */
+    BenchIdleQueueLoop bench;
+    guint i;
+
+    bench_idlequeue_loop_init(&bench, q, count);
+    for (i = 0; i < count; i++) {
+        gutil_idle_queue_add_tag(q, i + 1, bench_idlequeue_done, &bench);
+    }
+    bench_idlequeue_loop_run(&bench);
+    return count;
+}
+
+static
+guint
+bench_idlequeue_refill_tagged(
+    GUtilIdleQueue* q,
+    guint count)
+{
+    /*
+     * Tagged callbacks reusing the same tags, the queue gets drained
+     * and refilled. In a steady state that shouldn't allocate.
+     */
+    BenchIdleQueueLoop bench;
+    guint i, n, depth;
+
+    bench_idlequeue_loop_init(&bench, q, 0);
+    for (n = 0; n < count; n += depth) {
+        depth = MIN(count - n, BENCH_REFILL_DEPTH);
+        for (i = 0; i < depth; i++) {
+            gutil_idle_queue_add_tag(q, i + 1, bench_idlequeue_done,
+                &bench);
+        }
+        bench.remaining = depth;
+        g_main_loop_run(bench.loop);
+    }
+    g_main_loop_unref(bench.loop);
+    return count;
+}
+
+static
+guint
+bench_idlequeue_chain_run(
+    GUtilIdleQueue* q,
+    guint count)
+{
+    /* Callbacks enqueueing more work, the depth stays constant */
+    BenchIdleQueueLoop bench;
+    const guint depth = MIN(count, BENCH_CHAIN_DEPTH);
+    guint i;
+
+    bench_idlequeue_loop_init(&bench, q, count);
+    bench.to_add = count - depth;
+    for (i = 0; i < depth; i++) {
+        gutil_idle_queue_add(q, bench_idlequeue_chain, &bench);
+    }
+    bench_idlequeue_loop_run(&bench);
+    return count;
+}
+
+static
+guint
+bench_idlequeue_cancel(
+    GUtilIdleQueue* q,
+    guint count)
+{
+    /* Three quarters of the callbacks get cancelled by tag */
+    BenchIdleQueueLoop bench;
+    guint i, cancelled = 0;
+
+    bench_idlequeue_loop_init(&bench, q, (count + 3) / 4);
+    for (i = 0; i < count; i++) {
+        gutil_idle_queue_add_tag(q, i + 1, bench_idlequeue_done, &bench);
+    }
+    for (i = 0; i < count; i++) {
+        /* Multiplying by a large prime scrambles the order */
+        const guint t = (guint)(((guint64)i * 2654435761u) % count);
+
+        if (t % 4) {
+            cancelled += gutil_idle_queue_cancel_tag(q, t + 1);
+        }
+    }
+    bench_idlequeue_loop_run(&bench);
+    return count + cancelled;
+}
+
+static
+guint
+bench_idlequeue_unique(
+    GUtilIdleQueue* q,
+    guint count)
+{
+    /* Most add_unique() calls find a pending callback with the tag */
+    BenchIdleQueueLoop bench;
+    guint i;
+
+    bench_idlequeue_loop_init(&bench, q, 0);
+    for (i = 0; i < count; i++) {
+        bench.remaining += gutil_idle_queue_add_unique(q,
+            i % BENCH_UNIQUE_TAGS + 1, bench_idlequeue_done, &bench, NULL);
+    }
+    bench_idlequeue_loop_run(&bench);
+    return count;
+}
+
+static
+guint
+bench_idlequeue_lookup(
+    GUtilIdleQueue* q,
+    guint count,
+    guint depth)
+{
+    /* Tag lookups in a queue of the given depth, half of them miss */
+    guint32 seed = 1;
+    gsize found = 0;
+    guint i;
+
+    for (i = 0; i < depth; i++) {
+        gutil_idle_queue_add_tag(q, i + 1, NULL, NULL);
+    }
+    for (i = 0; i < count; i++) {
+        seed = seed * 1103515245 + 12345;
+        found += gutil_idle_queue_contains_tag(q, (seed >> 8) %
+            (2 * depth) + 1);
+    }
+    bench_sink += found;
+    gutil_idle_queue_cancel_all(q);
+    return count;
+}
+
+static
+guint
+bench_idlequeue_lookup_16(
+    GUtilIdleQueue* q,
+    guint count)
+{
+    return bench_idlequeue_lookup(q, count, 16);
+}
+
+static
+guint
+bench_idlequeue_lookup_1k(
+    GUtilIdleQueue* q,
+    guint count)
+{
+    return bench_idlequeue_lookup(q, count, 1024);
+}
+
+static
+guint
+bench_idlequeue_lookup_64k(
+    GUtilIdleQueue* q,
+    guint count)
+{
+    return bench_idlequeue_lookup(q, count, 65536);
+}
+
+static const BenchIdleQueue bench_idlequeue_all[] = {
+    { "add_run", bench_idlequeue_add_run },
+    { "add_run_tagged", bench_idlequeue_add_run_tagged },
+    { "refill_tagged", bench_idlequeue_refill_tagged },
+    { "chain", bench_idlequeue_chain_run },
+    { "cancel", bench_idlequeue_cancel },
+    { "unique", bench_idlequeue_unique },
+    { "lookup_16", bench_idlequeue_lookup_16 },
+    { "lookup_1k", bench_idlequeue_lookup_1k },
+    { "lookup_64k", bench_idlequeue_lookup_64k }
+};
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+static
+gboolean
+bench_idlequeue_selected(
+    const char* name,
+    char** names,
+    int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (!strcmp(names[i], name)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+int main(int argc, char* argv[])
+{
+    guint count = BENCH_DEFAULT_COUNT;
+    guint repeat = BENCH_DEFAULT_REPEAT;
+    char** names;
+    int i, j, k, nnames = 0;
+    gboolean any_bench = FALSE, any_type = FALSE;
+
+    /* Must be done before anything gets allocated from a slice */
+    g_setenv("G_SLICE", "always-malloc", TRUE);
+    names = g_new0(char*, argc);
+    for (i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+
+        if (!strcmp(arg, "-n") && (i + 1) < argc) {
+            count = (guint) atoi(argv[++i]);
+        } else if (!strcmp(arg, "-r") && (i + 1) < argc) {
+            repeat = (guint) atoi(argv[++i]);
+        } else if (arg[0] == '-') {
+            printf("Usage: %s [-n COUNT] [-r REPEAT] [BENCHMARK|VARIANT...]\n",
+                argv[0]);
+            g_free(names);
+            return 1;
+        } else {
+            names[nnames++] = argv[i];
+        }
+    }
+
+    /* Empty filter means everything */
+    for (i = 0; i < (int) G_N_ELEMENTS(bench_idlequeue_all); i++) {
+        any_bench |= bench_idlequeue_selected(bench_idlequeue_all[i].name,
+            names, nnames);
+    }
+    for (i = 0; i < (int) G_N_ELEMENTS(bench_idlequeue_types); i++) {
+        any_type |= bench_idlequeue_selected(bench_idlequeue_types[i].name,
+            names, nnames);
+    }
+
+    printf("%-16s %-10s %10s %10s %10s\n", "benchmark", "variant",
+        "Mops/s", "ns/op", "allocs/op");
+    for (i = 0; i < (int) G_N_ELEMENTS(bench_idlequeue_all); i++) {
+        const BenchIdleQueue* bench = bench_idlequeue_all + i;
+
+        if (any_bench && !bench_idlequeue_selected(bench->name,
+            names, nnames)) {
+            continue;
+        }
+        for (j = 0; j < (int) G_N_ELEMENTS(bench_idlequeue_types); j++) {
+            const BenchIdleQueueType* type = bench_idlequeue_types + j;
+            gint64 best = G_MAXINT64;
+            gsize allocs = 0;
+            guint ops = 0;
+
+            if (any_type && !bench_idlequeue_selected(type->name,
+                names, nnames)) {
+                continue;
+            }
+
+            /* Take the best of several runs, each with a fresh queue */
+            for (k = 0; k < (int) MAX(repeat, 1); k++) {
+                GUtilIdleQueue* q = gutil_idle_queue_new();
+                gsize allocs_before;
+                gint64 start;
+
+                type->setup(q);
+                allocs_before = BENCH_ALLOCS();
+                start = g_get_monotonic_time();
+                ops = bench->run(q, count);
+                best = MIN(best, g_get_monotonic_time() - start);
+                allocs = BENCH_ALLOCS() - allocs_before;
+                gutil_idle_queue_free(q);
+            }
+            best = MAX(best, 1);
+            ops = MAX(ops, 1);
+            printf("%-16s %-10s %10.2f %10.2f %10.3f\n", bench->name,
+                type->name, (double) ops / best, best * 1000.0 / ops,
+                (double) allocs / ops);
+        }
+    }
+    g_free(names);
+    return 0;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,455 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * GUtilRing microbenchmarks. Every benchmark is run against every
+ * ring variant listed in bench_ring_types, so that's the only place
+ * to touch when a new kind of ring needs to be measured.
+ *
+ * Usage: bench_ring [-n COUNT] [-r REPEAT] [BENCHMARK|VARIANT...]
+ */
+
+#include "gutil_ring.h"
+
+#include <stdlib.h>
+
+#define BENCH_DEFAULT_COUNT (1000000)
+#define BENCH_DEFAULT_REPEAT (3)
+#define BENCH_BOUNDED_SIZE (1024)
+#define BENCH_RANDOM_SIZE (65536)
+#define BENCH_FLATTEN_SIZE (4096)
+
+typedef struct bench_ring_type {
+    const char* name;
+    GUtilRing* (*create)(gint max_size);
+} BenchRingType;
+
+typedef struct bench_ring {
+    const char* name;
+    /* Returns the number of operations performed */
+    guint (*run)(const BenchRingType* type, guint count);
+} BenchRing;
+
+/* Prevents the compiler from optimizing the loops away */
+static volatile gsize bench_sink;
+
+/*==========================================================================*
+ * Variants
+ *==========================================================================*/
+
+static
+GUtilRing*
+bench_ring_plain_new(
+    gint max_size)
+{
+    return gutil_ring_sized_new(0, max_size);
+}
+
+static
+GUtilRing*
+bench_ring_segmented_new(
+    gint max_size)
+{
+    return gutil_ring_segmented_new(0, max_size, NULL);
+}
+
+static const BenchRingType bench_ring_types[] = {
+    { "plain", bench_ring_plain_new },
+    { "segmented", bench_ring_segmented_new }
+};
+
+/*==========================================================================*
+ * Benchmarks
+ *==========================================================================*/
+
+static
+guint
+bench_ring_fill_drain(
+    const BenchRingType* type,
+    guint count)
+{
+    /* Unbounded growth from empty, then draining it */
+    GUtilRing* r = type->create(GUTIL_RING_UNLIMITED_SIZE);
+    gsize sum = 0;
+    guint i;
+
+    for (i = 0; i < count; i++) {
+        gutil_ring_put(r, GSIZE_TO_POINTER(i));
+    }
+    for (i = 0; i < count; i++) {
+        sum += GPOINTER_TO_SIZE(gutil_ring_get(r));
+    }
+    bench_sink += sum;
+    gutil_ring_unref(r);
+    return 2 * count;
+}
+
+static
+guint
+bench_ring_fifo(
+    const BenchRingType* type,
+    guint count)
+{
+    /* Steady state put/get on an unbounded ring */
+    GUtilRing* r = type->create(GUTIL_RING_UNLIMITED_SIZE);
+    gsize sum = 0;
+    guint i;
+
+    for (i = 0; i < BENCH_BOUNDED_SIZE / 2; i++) {
+        gutil_ring_put(r, GSIZE_TO_POINTER(i));
+    }
+    for (i = 0; i < count; i++) {
+        gutil_ring_put(r, GSIZE_TO_POINTER(i));
+        sum += GPOINTER_TO_SIZE(gutil_ring_get(r));
+    }
+    bench_sink += sum;
+    gutil_ring_unref(r);
+    return 2 * count;
+}
+
+static
+guint
+bench_ring_bounded(
+    const BenchRingType* type,
+    guint count)
+{
+    /* Bounded ring, the caller makes room when it's full */
+    GUtilRing* r = type->create(BENCH_BOUNDED_SIZE);
+    guint i;
+
+    for (i = 0; i < count; i++) {
+        if (!gutil_ring_put(r, GSIZE_TO_POINTER(i))) {
+            gutil_ring_drop(r, 1);
+            gutil_ring_put(r, GSIZE_TO_POINTER(i));
+        }
+    }
+    bench_sink += gutil_ring_size(r);
+    gutil_ring_unref(r);
+    return count;
+}
+
+static
+guint
+bench_ring_overwrite(
+    const BenchRingType* type,
+    guint count)
+{
+    /* Same as above but letting the ring to evict the oldest element */
+    GUtilRing* r = type->create(BENCH_BOUNDED_SIZE);
+    guint i;
+
+    gutil_ring_set_flags(r, GUTIL_RING_FLAG_OVERWRITE);
+    for (i = 0; i < count; i++) {
+        gutil_ring_put(r, GSIZE_TO_POINTER(i));
+    }
+    bench_sink += gutil_ring_size(r);
+    gutil_ring_unref(r);
+    return count;
+}
+
+static
+guint
+bench_ring_front_last(
+    const BenchRingType* type,
+    guint count)
+{
+    /* LIFO at the wrong end: put_front/get_last */
+    GUtilRing* r = type->create(GUTIL_RING_UNLIMITED_SIZE);
+    gsize sum = 0;
+    guint i;
+
+    for (i = 0; i < BENCH_BOUNDED_SIZE / 2; i++) {
+        gutil_ring_put_front(r, GSIZE_TO_POINTER(i));
+    }
+    for (i = 0; i < count; i++) {
+        gutil_ring_put_front(r, GSIZE_TO_POINTER(i));
+        sum += GPOINTER_TO_SIZE(gutil_ring_get_last(r));
+    }
+    bench_sink += sum;
+    gutil_ring_unref(r);
+    return 2 * count;
+}
+
+static
+guint
+bench_ring_data_at(
+    const BenchRingType* type,
+    guint count)
+{
+    /* Random access into a wrapped ring */
+    GUtilRing* r = type->create(GUTIL_RING_UNLIMITED_SIZE);
+    const gint n = BENCH_RANDOM_SIZE;
+    guint32 seed = 1;
+    gsize sum = 0;
+    guint i;
+
+    for (i = 0; i < (guint) n; i++) {
+        gutil_ring_put(r, GSIZE_TO_POINTER(i));
+    }
+    gutil_ring_drop(r, n / 2);
+    for (i = 0; i < (guint) n / 2; i++) {
+        gutil_ring_put(r, GSIZE_TO_POINTER(i));
+    }
+    for (i = 0; i < count; i++) {
+        /* Cheap LCG, we don't want to benchmark the random generator */
+        seed = seed * 1103515245 + 12345;
+        sum += GPOINTER_TO_SIZE(gutil_ring_data_at(r, (seed >> 8) % n));
+    }
+    bench_sink += sum;
+    gutil_ring_unref(r);
+    return count;
+}
+
+static
+guint
+bench_ring_grow_compact(
+    const BenchRingType* type,
+    guint count)
+{
+    /* Growth from scratch followed by compaction, again and again */
+    GUtilRing* r = type->create(GUTIL_RING_UNLIMITED_SIZE);
+    const guint n = BENCH_RANDOM_SIZE;
+    guint i, done = 0;
+
+    while (done < count) {
+        const guint m = MIN(n, count - done);
+
+        for (i = 0; i < m; i++) {
+            gutil_ring_put(r, GSIZE_TO_POINTER(i));
+        }
+        gutil_ring_clear(r);
+        gutil_ring_compact(r);
+        done += m;
+    }
+    gutil_ring_unref(r);
+    return count;
+}
+
+static
+guint
+bench_ring_reserve(
+    const BenchRingType* type,
+    guint count)
+{
+    /* Same as above, with the space reserved upfront */
+    GUtilRing* r = type->create(GUTIL_RING_UNLIMITED_SIZE);
+    const guint n = BENCH_RANDOM_SIZE;
+    guint i, done = 0;
+
+    while (done < count) {
+        const guint m = MIN(n, count - done);
+
+        gutil_ring_reserve(r, m);
+        for (i = 0; i < m; i++) {
+            gutil_ring_put(r, GSIZE_TO_POINTER(i));
+        }
+        gutil_ring_clear(r);
+        gutil_ring_compact(r);
+        done += m;
+    }
+    gutil_ring_unref(r);
+    return count;
+}
+
+static
+guint
+bench_ring_flatten(
+    const BenchRingType* type,
+    guint count)
+{
+    /* Flattening a wrapped ring, counted per element */
+    GUtilRing* r = type->create(GUTIL_RING_UNLIMITED_SIZE);
+    const guint n = BENCH_FLATTEN_SIZE;
+    guint i, done = 0;
+
+    for (i = 0; i < n; i++) {
+        gutil_ring_put(r, GSIZE_TO_POINTER(i));
+    }
+    while (done < count) {
+        gint size;
+
+        /* Rotate by half to wrap it around */
+        for (i = 0; i < n / 2; i++) {
+            gutil_ring_put(r, gutil_ring_get(r));
+        }
+        bench_sink += GPOINTER_TO_SIZE(gutil_ring_flatten(r, &size)[size/2]);
+        done += n;
+    }
+    gutil_ring_unref(r);
+    return done;
+}
+
+static
+void
+bench_ring_foreach_cb(
+    gpointer data,
+    gpointer user_data)
+{
+    *((gsize*)user_data) += GPOINTER_TO_SIZE(data);
+}
+
+static
+guint
+bench_ring_foreach(
+    const BenchRingType* type,
+    guint count)
+{
+    /* Walking the whole ring */
+    GUtilRing* r = type->create(GUTIL_RING_UNLIMITED_SIZE);
+    const guint n = BENCH_RANDOM_SIZE;
+    gsize sum = 0;
+    guint i, done = 0;
+
+    for (i = 0; i < n; i++) {
+        gutil_ring_put(r, GSIZE_TO_POINTER(i));
+    }
+    gutil_ring_drop(r, n / 2);
+    for (i = 0; i < n / 2; i++) {
+        gutil_ring_put(r, GSIZE_TO_POINTER(i));
+    }
+    while (done < count) {
+        gutil_ring_foreach(r, bench_ring_foreach_cb, &sum);
+        done += n;
+    }
+    bench_sink += sum;
+    gutil_ring_unref(r);
+    return done;
+}
+
+static const BenchRing bench_ring_all[] = {
+    { "fill_drain", bench_ring_fill_drain },
+    { "fifo", bench_ring_fifo },
+    { "bounded", bench_ring_bounded },
+    { "overwrite", bench_ring_overwrite },
+    { "front_last", bench_ring_front_last },
+    { "data_at", bench_ring_data_at },
+    { "grow_compact", bench_ring_grow_compact },
+    { "reserve", bench_ring_reserve },
+    { "flatten", bench_ring_flatten },
+    { "foreach", bench_ring_foreach }
+};
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+static
+gboolean
+bench_ring_selected(
+    const char* name,
+    char** names,
+    int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (!strcmp(names[i], name)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+int main(int argc, char* argv[])
+{
+    guint count = BENCH_DEFAULT_COUNT;
+    guint repeat = BENCH_DEFAULT_REPEAT;
+    char** names = g_new0(char*, argc);
+    int i, j, k, nnames = 0;
+    gboolean any_bench = FALSE, any_type = FALSE;
+
+    for (i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+
+        if (!strcmp(arg, "-n") && (i + 1) < argc) {
+            count = (guint) atoi(argv[++i]);
+        } else if (!strcmp(arg, "-r") && (i + 1) < argc) {
+            repeat = (guint) atoi(argv[++i]);
+        } else if (arg[0] == '-') {
+            printf("Usage: %s [-n COUNT] [-r REPEAT] [BENCHMARK|VARIANT...]\n",
+                argv[0]);
+            g_free(names);
+            return 1;
+        } else {
+            names[nnames++] = argv[i];
+        }
+    }
+
+    /* Empty filter means everything */
+    for (i = 0; i < (int) G_N_ELEMENTS(bench_ring_all); i++) {
+        any_bench |= bench_ring_selected(bench_ring_all[i].name,
+            names, nnames);
+    }
+    for (i = 0; i < (int) G_N_ELEMENTS(bench_ring_types); i++) {
+        any_type |= bench_ring_selected(bench_ring_types[i].name,
+            names, nnames);
+    }
+
+    printf("%-14s %-10s %12s %10s\n", "benchmark", "variant", "Mops/s",
+        "ns/op");
+    for (i = 0; i < (int) G_N_ELEMENTS(bench_ring_all); i++) {
+        const BenchRing* bench = bench_ring_all + i;
+
+        if (any_bench && !bench_ring_selected(bench->name, names, nnames)) {
+            continue;
+        }
+        for (j = 0; j < (int) G_N_ELEMENTS(bench_ring_types); j++) {
+            const BenchRingType* type = bench_ring_types + j;
+            gint64 best = G_MAXINT64;
+            guint ops = 0;
+
+            if (any_type && !bench_ring_selected(type->name, names, nnames)) {
+                continue;
+            }
+
+            /* Take the best of several runs */
+            for (k = 0; k < (int) MAX(repeat, 1); k++) {
+                const gint64 start = g_get_monotonic_time();
+
+                ops = bench->run(type, count);
+                best = MIN(best, g_get_monotonic_time() - start);
+            }
+            best = MAX(best, 1);
+            printf("%-14s %-10s %12.2f %10.2f\n", bench->name, type->name,
+                (double) ops / best, best * 1000.0 / ops);
+        }
+    }
+    g_free(names);
+    return 0;
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
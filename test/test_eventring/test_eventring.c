@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_common.h"
+
+#include "gutil_eventring.h"
+#include "gutil_log.h"
+
+#define TEST_TIMEOUT (10) /* seconds */
+
+static TestOpt test_opt;
+
+typedef struct test_eventring_data {
+    GMainLoop* loop;
+    guint expected;
+    guint received;
+    guint dispatched;
+    gboolean in_order;
+} TestEventRingData;
+
+static
+gboolean
+test_eventring_timeout(
+    gpointer param)
+{
+    g_assert(!"TIMEOUT");
+    return G_SOURCE_REMOVE;
+}
+
+static
+guint
+test_eventring_timeout_start(
+    void)
+{
+    return (test_opt.flags & TEST_FLAG_DEBUG) ? 0 :
+        g_timeout_add_seconds(TEST_TIMEOUT, test_eventring_timeout, NULL);
+}
+
+static
+void
+test_eventring_int_inc(
+    gpointer data)
+{
+    int* ptr = data;
+    (*ptr)++;
+}
+
+static
+void
+test_eventring_cb(
+    GUtilEventRing* ring,
+    gpointer* data,
+    guint count,
+    gpointer user_data)
+{
+    TestEventRingData* test = user_data;
+    guint i;
+
+    GDEBUG("Received %u item(s)", count);
+    g_assert(count > 0);
+    for (i = 0; i < count; i++) {
+        if (GPOINTER_TO_UINT(data[i]) != test->received + i + 1) {
+            test->in_order = FALSE;
+        }
+    }
+    test->received += count;
+    test->dispatched++;
+    if (test->received >= test->expected) {
+        g_main_loop_quit(test->loop);
+    }
+}
+
+/*==========================================================================*
+ * Null
+ *==========================================================================*/
+
+static
+void
+test_eventring_null(
+    void)
+{
+    gpointer data = NULL;
+
+    g_assert(!gutil_event_ring_ref(NULL));
+    gutil_event_ring_unref(NULL);
+    g_assert(!gutil_event_ring_size(NULL));
+    g_assert(!gutil_event_ring_put(NULL, NULL));
+    g_assert(!gutil_event_ring_put_batch(NULL, &data, 1));
+    g_assert(!gutil_event_ring_source_new(NULL, NULL, NULL, NULL));
+    g_assert(!gutil_event_ring_add_handler(NULL, NULL, NULL));
+}
+
+/*==========================================================================*
+ * Basic
+ *==========================================================================*/
+
+static
+void
+test_eventring_basic(
+    void)
+{
+    int freed = 0;
+    guint timeout_id = test_eventring_timeout_start();
+    GUtilEventRing* ring = gutil_event_ring_new(-1, test_eventring_int_inc);
+    TestEventRingData test;
+    guint id;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, TRUE);
+    test.expected = 3;
+    test.in_order = TRUE;
+
+    g_assert(ring);
+    g_assert(gutil_event_ring_ref(ring) == ring);
+    gutil_event_ring_unref(ring);
+    g_assert(!gutil_event_ring_put_batch(ring, NULL, 0));
+
+    /* Data is being passed to the callback in one batch */
+    g_assert(gutil_event_ring_put(ring, &freed));
+    g_assert(gutil_event_ring_put(ring, &freed));
+    g_assert(gutil_event_ring_put(ring, &freed));
+    g_assert_cmpint(gutil_event_ring_size(ring), == ,3);
+
+    id = gutil_event_ring_add_handler(ring, test_eventring_cb, &test);
+    g_assert(id);
+    g_main_loop_run(test.loop);
+
+    g_assert_cmpuint(test.received, == ,3);
+    g_assert_cmpuint(test.dispatched, == ,1);
+    g_assert_cmpint(gutil_event_ring_size(ring), == ,0);
+    /* Free function is called after the callback */
+    g_assert_cmpint(freed, == ,3);
+
+    /* Pending data is freed together with the ring */
+    g_assert(gutil_event_ring_put(ring, &freed));
+    g_source_remove(id);
+    gutil_event_ring_unref(ring);
+    g_assert_cmpint(freed, == ,4);
+
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * Limit
+ *==========================================================================*/
+
+static
+void
+test_eventring_limit(
+    void)
+{
+    gpointer data[3];
+    GUtilEventRing* ring = gutil_event_ring_new(2, NULL);
+
+    memset(data, 0, sizeof(data));
+    g_assert_cmpuint(gutil_event_ring_put_batch(ring, data,
+        G_N_ELEMENTS(data)), == ,2);
+    g_assert(!gutil_event_ring_put(ring, NULL));
+    g_assert_cmpint(gutil_event_ring_size(ring), == ,2);
+    gutil_event_ring_unref(ring);
+}
+
+/*==========================================================================*
+ * Thread
+ *==========================================================================*/
+
+#define TEST_THREAD_BATCH (10)
+#define TEST_THREAD_COUNT (100)
+
+static
+gpointer
+test_eventring_thread(
+    gpointer ring)
+{
+    guint i, k = 0;
+
+    for (i = 0; i < TEST_THREAD_COUNT; i++) {
+        gpointer data[TEST_THREAD_BATCH];
+        guint j;
+
+        for (j = 0; j < TEST_THREAD_BATCH; j++) {
+            data[j] = GUINT_TO_POINTER(++k);
+        }
+        g_assert_cmpuint(gutil_event_ring_put_batch(ring, data,
+            TEST_THREAD_BATCH), == ,TEST_THREAD_BATCH);
+    }
+    return NULL;
+}
+
+static
+void
+test_eventring_thread_test(
+    void)
+{
+    guint timeout_id = test_eventring_timeout_start();
+    GUtilEventRing* ring = gutil_event_ring_new(-1, NULL);
+    GSource* source;
+    GThread* thread;
+    TestEventRingData test;
+
+    memset(&test, 0, sizeof(test));
+    test.loop = g_main_loop_new(NULL, TRUE);
+    test.expected = TEST_THREAD_BATCH * TEST_THREAD_COUNT;
+    test.in_order = TRUE;
+
+    source = gutil_event_ring_source_new(ring, test_eventring_cb, &test, NULL);
+    g_source_attach(source, NULL);
+    thread = g_thread_new("test", test_eventring_thread, ring);
+    g_main_loop_run(test.loop);
+    g_thread_join(thread);
+
+    /* Wakeups are coalesced */
+    GDEBUG("%u dispatch(es)", test.dispatched);
+    g_assert_cmpuint(test.received, == ,test.expected);
+    g_assert_cmpuint(test.dispatched, <= ,TEST_THREAD_COUNT);
+    g_assert(test.in_order);
+
+    g_source_destroy(source);
+    g_source_unref(source);
+    gutil_event_ring_unref(ring);
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+    g_main_loop_unref(test.loop);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_PREFIX "/eventring/"
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_PREFIX "null", test_eventring_null);
+    g_test_add_func(TEST_PREFIX "basic", test_eventring_basic);
+    g_test_add_func(TEST_PREFIX "limit", test_eventring_limit);
+    g_test_add_func(TEST_PREFIX "thread", test_eventring_thread_test);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_common.h"
+
+#include "gutil_ewma.h"
+
+#include <math.h>
+
+static TestOpt test_opt;
+static gint64 test_ewma_time;
+
+#define TEST_EPSILON (1e-9)
+
+static
+gint64
+test_ewma_time_func(void)
+{
+    return test_ewma_time;
+}
+
+static
+void
+test_ewma_assert_equal(
+    double d1,
+    double d2)
+{
+    g_assert(fabs(d1 - d2) < TEST_EPSILON);
+}
+
+/*==========================================================================*
+ * NULL tolerance
+ *==========================================================================*/
+
+static
+void
+test_ewma_null(
+    void)
+{
+    gutil_ewma_unref(NULL);
+    gutil_ewma_clear(NULL);
+    g_assert(!gutil_ewma_ref(NULL));
+    g_assert(gutil_ewma_add(NULL, 1) == 0);
+    g_assert(gutil_ewma_mean(NULL, 1) == 1);
+    g_assert(gutil_ewma_variance(NULL, 1) == 1);
+    g_assert(!gutil_ewma_new(0));
+    g_assert(!gutil_ewma_new_full(-1, test_ewma_time_func));
+}
+
+/*==========================================================================*
+ * Basic
+ *==========================================================================*/
+
+static
+void
+test_ewma_basic(
+    void)
+{
+    /* The default time function returns real time, not usable for testing */
+    GUtilEwma* e = gutil_ewma_new(GUTIL_HISTORY_SEC);
+
+    g_assert(gutil_ewma_mean(e, -1) == -1);
+    g_assert(gutil_ewma_variance(e, -1) == -1);
+    g_assert(gutil_ewma_add(e, 2) == 2);
+    g_assert(gutil_ewma_variance(e, -1) == 0);
+    gutil_ewma_unref(gutil_ewma_ref(e));
+    gutil_ewma_clear(e);
+    g_assert(gutil_ewma_mean(e, -1) == -1);
+    gutil_ewma_unref(e);
+}
+
+/*==========================================================================*
+ * Weight
+ *==========================================================================*/
+
+static
+void
+test_ewma_weight(
+    void)
+{
+    const gint64 tau = 10;
+    GUtilEwma* e = gutil_ewma_new_full(tau, test_ewma_time_func);
+    const double a = 1 - exp(-1.0);
+
+    test_ewma_time = 100;
+    test_ewma_assert_equal(gutil_ewma_add(e, 10), 10);
+
+    /* After tau, the new sample gets the weight of 1 - 1/e */
+    test_ewma_time += tau;
+    test_ewma_assert_equal(gutil_ewma_add(e, 20), 10 + 10 * a);
+    test_ewma_assert_equal(gutil_ewma_variance(e, -1), (1 - a) * 100 * a);
+
+    /* Same time, the last sample is replaced */
+    test_ewma_assert_equal(gutil_ewma_add(e, 0), 10 - 10 * a);
+    test_ewma_assert_equal(gutil_ewma_variance(e, -1), (1 - a) * 100 * a);
+
+    /* Time going back is treated the same way */
+    test_ewma_time--;
+    test_ewma_assert_equal(gutil_ewma_add(e, 20), 10 + 10 * a);
+    test_ewma_assert_equal(gutil_ewma_mean(e, -1), 10 + 10 * a);
+    gutil_ewma_unref(e);
+}
+
+/*==========================================================================*
+ * Irregular
+ *==========================================================================*/
+
+static
+void
+test_ewma_irregular(
+    void)
+{
+    const gint64 tau = 1000;
+    GUtilEwma* e1 = gutil_ewma_new_full(tau, test_ewma_time_func);
+    GUtilEwma* e2 = gutil_ewma_new_full(tau, test_ewma_time_func);
+    int i;
+
+    /*
+     * A constant signal sampled often and rarely must give the same
+     * result, no matter how the samples are distributed in time.
+     */
+    test_ewma_time = 0;
+    gutil_ewma_add(e1, 0);
+    gutil_ewma_add(e2, 0);
+    for (i = 0; i < 100; i++) {
+        test_ewma_time += 10;
+        gutil_ewma_add(e1, 1);
+    }
+    gutil_ewma_add(e2, 1);
+    test_ewma_assert_equal(gutil_ewma_mean(e1, -1), gutil_ewma_mean(e2, -1));
+    test_ewma_assert_equal(gutil_ewma_mean(e1, -1), 1 - exp(-1.0));
+
+    /* Converges to the constant value with zero variance */
+    for (i = 0; i < 100; i++) {
+        test_ewma_time += tau;
+        gutil_ewma_add(e1, 1);
+    }
+    test_ewma_assert_equal(gutil_ewma_mean(e1, -1), 1);
+    test_ewma_assert_equal(gutil_ewma_variance(e1, -1), 0);
+    gutil_ewma_unref(e1);
+    gutil_ewma_unref(e2);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_PREFIX "/ewma/"
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_PREFIX "null", test_ewma_null);
+    g_test_add_func(TEST_PREFIX "basic", test_ewma_basic);
+    g_test_add_func(TEST_PREFIX "weight", test_ewma_weight);
+    g_test_add_func(TEST_PREFIX "irregular", test_ewma_irregular);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,341 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_common.h"
+
+#include "gutil_histogram.h"
+
+static TestOpt test_opt;
+
+/*==========================================================================*
+ * NULL tolerance
+ *==========================================================================*/
+
+static
+void
+test_histogram_null(
+    void)
+{
+    GUtilHistogram* h = gutil_histogram_new(100, 1);
+
+    gutil_histogram_unref(NULL);
+    gutil_histogram_clear(NULL);
+    gutil_histogram_add(NULL, 0);
+    g_assert(!gutil_histogram_ref(NULL));
+    g_assert(!gutil_histogram_merge(NULL, NULL));
+    g_assert(!gutil_histogram_merge(h, NULL));
+    g_assert(!gutil_histogram_merge(NULL, h));
+    g_assert(!gutil_histogram_count(NULL));
+    g_assert(!gutil_histogram_min(NULL));
+    g_assert(!gutil_histogram_max(NULL));
+    g_assert(gutil_histogram_mean(NULL) == 0);
+    g_assert(!gutil_histogram_percentile(NULL, 50));
+    g_assert(!gutil_histogram_encode(NULL));
+    g_assert(!gutil_histogram_decode(NULL));
+    g_assert(!gutil_histogram_new(100, 0));
+    g_assert(!gutil_histogram_new(100,
+        GUTIL_HISTOGRAM_MAX_PRECISION_BITS + 1));
+    gutil_histogram_unref(h);
+}
+
+/*==========================================================================*
+ * Basic
+ *==========================================================================*/
+
+static
+void
+test_histogram_basic(
+    void)
+{
+    GUtilHistogram* h = gutil_histogram_new(1000, 4);
+    guint64 i;
+
+    g_assert(!gutil_histogram_count(h));
+    g_assert(!gutil_histogram_percentile(h, 50));
+    g_assert(gutil_histogram_mean(h) == 0);
+
+    /* Values below 16 are exact */
+    for (i = 1; i <= 10; i++) {
+        gutil_histogram_add(h, i);
+    }
+    gutil_histogram_unref(gutil_histogram_ref(h));
+    g_assert_cmpuint(gutil_histogram_count(h), == ,10);
+    g_assert_cmpuint(gutil_histogram_min(h), == ,1);
+    g_assert_cmpuint(gutil_histogram_max(h), == ,10);
+    g_assert(gutil_histogram_mean(h) == 5.5);
+    g_assert_cmpuint(gutil_histogram_percentile(h, 0), == ,1);
+    g_assert_cmpuint(gutil_histogram_percentile(h, 10), == ,1);
+    g_assert_cmpuint(gutil_histogram_percentile(h, 11), == ,2);
+    g_assert_cmpuint(gutil_histogram_percentile(h, 50), == ,5);
+    g_assert_cmpuint(gutil_histogram_percentile(h, 100), == ,10);
+    g_assert_cmpuint(gutil_histogram_percentile(h, 200), == ,10);
+
+    /* Values above max_value go to the last bucket */
+    gutil_histogram_add(h, 100000);
+    g_assert_cmpuint(gutil_histogram_max(h), == ,100000);
+    g_assert_cmpuint(gutil_histogram_percentile(h, 100), == ,100000);
+    g_assert_cmpuint(gutil_histogram_percentile(h, 99), >= ,1000);
+
+    gutil_histogram_clear(h);
+    g_assert(!gutil_histogram_count(h));
+    g_assert(!gutil_histogram_max(h));
+    gutil_histogram_unref(h);
+}
+
+/*==========================================================================*
+ * Precision
+ *==========================================================================*/
+
+static
+void
+test_histogram_precision(
+    void)
+{
+    const guint bits = 7;
+    GUtilHistogram* h = gutil_histogram_new(G_MAXUINT64, bits);
+    guint64 v;
+
+    /* Each value on its own, relative error is within 2^-bits */
+    for (v = 1; v < G_MAXUINT64 / 3; v = v * 3 + 1) {
+        guint64 p;
+
+        gutil_histogram_clear(h);
+        gutil_histogram_add(h, 0);
+        gutil_histogram_add(h, v);
+        gutil_histogram_add(h, G_MAXUINT64);
+        p = gutil_histogram_percentile(h, 50);
+        g_assert_cmpuint(p, >= ,v);
+        g_assert_cmpuint(p - v, <= ,v >> bits);
+    }
+    g_assert_cmpuint(gutil_histogram_percentile(h, 100), == ,G_MAXUINT64);
+    gutil_histogram_unref(h);
+}
+
+/*==========================================================================*
+ * Merge
+ *==========================================================================*/
+
+static
+void
+test_histogram_merge(
+    void)
+{
+    GUtilHistogram* h1 = gutil_histogram_new(1000000, 8);
+    GUtilHistogram* h2 = gutil_histogram_new(1000000, 8);
+    GUtilHistogram* h3 = gutil_histogram_new(1000000, 7);
+    GUtilHistogram* h4 = gutil_histogram_new(100000, 8);
+    GUtilHistogram* h5 = gutil_histogram_new(1000000, 8);
+    GUtilHistogram* all = gutil_histogram_new(1000000, 8);
+    int i;
+
+    for (i = 0; i < 1000; i++) {
+        const guint64 v = (i * 7919) % 100000;
+
+        gutil_histogram_add((i % 2) ? h1 : h2, v);
+        gutil_histogram_add(all, v);
+    }
+
+    g_assert(!gutil_histogram_merge(h1, h3));
+    g_assert(!gutil_histogram_merge(h1, h4));
+
+    /* Merging an empty one and merging into an empty one */
+    g_assert(gutil_histogram_merge(h2, h5));
+    g_assert_cmpuint(gutil_histogram_count(h2), == ,500);
+    g_assert(gutil_histogram_merge(h5, h2));
+    g_assert_cmpuint(gutil_histogram_count(h5), == ,500);
+    g_assert_cmpuint(gutil_histogram_min(h5), == ,gutil_histogram_min(h2));
+    g_assert_cmpuint(gutil_histogram_max(h5), == ,gutil_histogram_max(h2));
+
+    g_assert(gutil_histogram_merge(h1, h2));
+    g_assert_cmpuint(gutil_histogram_count(h1), == ,1000);
+    g_assert_cmpuint(gutil_histogram_min(h1), == ,gutil_histogram_min(all));
+    g_assert_cmpuint(gutil_histogram_max(h1), == ,gutil_histogram_max(all));
+    g_assert(gutil_histogram_mean(h1) == gutil_histogram_mean(all));
+    for (i = 0; i <= 100; i++) {
+        g_assert_cmpuint(gutil_histogram_percentile(h1, i), == ,
+            gutil_histogram_percentile(all, i));
+    }
+
+    gutil_histogram_unref(h1);
+    gutil_histogram_unref(h2);
+    gutil_histogram_unref(h3);
+    gutil_histogram_unref(h4);
+    gutil_histogram_unref(h5);
+    gutil_histogram_unref(all);
+}
+
+/*==========================================================================*
+ * Encode
+ *==========================================================================*/
+
+static
+void
+test_histogram_encode(
+    void)
+{
+    GUtilHistogram* h = gutil_histogram_new(1000000, 6);
+    GUtilHistogram* h2;
+    GBytes* bytes;
+    GUtilData data;
+    int i;
+
+    /* Empty */
+    bytes = gutil_histogram_encode(h);
+    data.bytes = g_bytes_get_data(bytes, &data.size);
+    h2 = gutil_histogram_decode(&data);
+    g_assert(h2);
+    g_assert(!gutil_histogram_count(h2));
+    gutil_histogram_unref(h2);
+    g_bytes_unref(bytes);
+
+    for (i = 0; i < 1000; i++) {
+        gutil_histogram_add(h, (i * 7919) % 10000);
+    }
+    gutil_histogram_add(h, 2000000);
+
+    bytes = gutil_histogram_encode(h);
+    data.bytes = g_bytes_get_data(bytes, &data.size);
+    h2 = gutil_histogram_decode(&data);
+    g_assert(h2);
+    g_assert_cmpuint(gutil_histogram_count(h2), == ,1001);
+    g_assert_cmpuint(gutil_histogram_min(h2), == ,gutil_histogram_min(h));
+    g_assert_cmpuint(gutil_histogram_max(h2), == ,2000000);
+    g_assert(gutil_histogram_mean(h2) == gutil_histogram_mean(h));
+    for (i = 0; i <= 100; i++) {
+        g_assert_cmpuint(gutil_histogram_percentile(h2, i), == ,
+            gutil_histogram_percentile(h, i));
+    }
+
+    /* Decoded histogram can be merged with the original */
+    g_assert(gutil_histogram_merge(h2, h));
+    g_assert_cmpuint(gutil_histogram_count(h2), == ,2002);
+    gutil_histogram_unref(h2);
+
+    /* Truncated data */
+    while (data.size > 0) {
+        data.size--;
+        g_assert(!gutil_histogram_decode(&data));
+    }
+    g_bytes_unref(bytes);
+    gutil_histogram_unref(h);
+}
+
+static
+gboolean
+test_histogram_decode_fails(
+    const void* bytes,
+    gsize size)
+{
+    GUtilData data;
+
+    data.bytes = bytes;
+    data.size = size;
+    return !gutil_histogram_decode(&data);
+}
+
+static
+void
+test_histogram_decode_bad(
+    void)
+{
+    static const guint8 bad_bits[] = { 0x00, 0x01, 0x00, 0x00, 0x00, 0x00 };
+    static const guint8 too_many_bits[] = {
+        0x11, 0x01, 0x00, 0x00, 0x00, 0x00
+    };
+    static const guint8 bad_count[] = {
+        0x01, 0x10, 0x02, 0x02, 0x01, 0x01, 0x01, 0x01
+    };
+    static const guint8 bad_gap[] = {
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x02, 0x01
+    };
+    static const guint8 zero_count[] = {
+        0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+    };
+    static const guint8 bad_minmax[] = {
+        0x01, 0x01, 0x01, 0x01, 0x02, 0x01, 0x01, 0x01
+    };
+    static const guint8 bad_mbn[] = {
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x81
+    };
+    /* 16 bits of precision over the whole 64-bit range, ~3.3M buckets */
+    static const guint8 huge_range[] = {
+        0x10, 0x81, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f,
+        0x00, 0x00, 0x00, 0x00
+    };
+    static const guint8 good[] = {
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01
+    };
+    GUtilHistogram* h;
+    GUtilData data;
+
+    g_assert(test_histogram_decode_fails(TEST_ARRAY_AND_SIZE(bad_bits)));
+    g_assert(test_histogram_decode_fails(TEST_ARRAY_AND_SIZE(too_many_bits)));
+    g_assert(test_histogram_decode_fails(TEST_ARRAY_AND_SIZE(bad_count)));
+    g_assert(test_histogram_decode_fails(TEST_ARRAY_AND_SIZE(bad_gap)));
+    g_assert(test_histogram_decode_fails(TEST_ARRAY_AND_SIZE(zero_count)));
+    g_assert(test_histogram_decode_fails(TEST_ARRAY_AND_SIZE(bad_minmax)));
+    g_assert(test_histogram_decode_fails(TEST_ARRAY_AND_SIZE(bad_mbn)));
+    g_assert(test_histogram_decode_fails(TEST_ARRAY_AND_SIZE(huge_range)));
+
+    TEST_INIT_DATA(data, good);
+    h = gutil_histogram_decode(&data);
+    g_assert(h);
+    g_assert_cmpuint(gutil_histogram_count(h), == ,1);
+    g_assert_cmpuint(gutil_histogram_percentile(h, 50), == ,1);
+    gutil_histogram_unref(h);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_PREFIX "/histogram/"
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_PREFIX "null", test_histogram_null);
+    g_test_add_func(TEST_PREFIX "basic", test_histogram_basic);
+    g_test_add_func(TEST_PREFIX "precision", test_histogram_precision);
+    g_test_add_func(TEST_PREFIX "merge", test_histogram_merge);
+    g_test_add_func(TEST_PREFIX "encode", test_histogram_encode);
+    g_test_add_func(TEST_PREFIX "decode_bad", test_histogram_decode_bad);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -34,6 +34,8 @@
 
 #include "gutil_history.h"
 
+#include <math.h>
+
 static TestOpt test_opt;
 static gint64 test_history_time;
 
@@ -60,9 +62,36 @@ test_history_null(
     g_assert(!gutil_int_history_interval(NULL));
     g_assert(!gutil_int_history_add(NULL, 1));
     g_assert(!gutil_int_history_median(NULL, 0));
+    g_assert(!gutil_int_history_percentile(NULL, 50, 0));
+    g_assert(!gutil_int_history_min(NULL, 0));
+    g_assert(!gutil_int_history_max(NULL, 0));
     g_assert(!gutil_int_history_new(0, 0));
     g_assert(!gutil_int_history_new(1, 0));
     g_assert(!gutil_int_history_new(0, 1));
+
+    gutil_int64_history_unref(NULL);
+    gutil_int64_history_clear(NULL);
+    g_assert(!gutil_int64_history_ref(NULL));
+    g_assert(!gutil_int64_history_size(NULL));
+    g_assert(!gutil_int64_history_interval(NULL));
+    g_assert(!gutil_int64_history_add(NULL, 1));
+    g_assert(!gutil_int64_history_median(NULL, 0));
+    g_assert(!gutil_int64_history_percentile(NULL, 50, 0));
+    g_assert(!gutil_int64_history_min(NULL, 0));
+    g_assert(!gutil_int64_history_max(NULL, 0));
+    g_assert(!gutil_int64_history_new(0, 1));
+
+    gutil_double_history_unref(NULL);
+    gutil_double_history_clear(NULL);
+    g_assert(!gutil_double_history_ref(NULL));
+    g_assert(!gutil_double_history_size(NULL));
+    g_assert(!gutil_double_history_interval(NULL));
+    g_assert(gutil_double_history_add(NULL, 1) == 0);
+    g_assert(gutil_double_history_median(NULL, 0) == 0);
+    g_assert(gutil_double_history_percentile(NULL, 50, 0) == 0);
+    g_assert(gutil_double_history_min(NULL, 0) == 0);
+    g_assert(gutil_double_history_max(NULL, 0) == 0);
+    g_assert(!gutil_double_history_new(1, 0));
 }
 
 /*==========================================================================*
@@ -196,6 +225,480 @@ test_history_interval(
     gutil_int_history_unref(h);
 }
 
+/*==========================================================================*
+ * Long
+ *==========================================================================*/
+
+static
+int
+test_history_long_median(
+    const int* values,
+    int first,
+    int last)
+{
+    /* Timestamps are equal to the indices */
+    gint64 area = 0;
+    int i;
+
+    for (i = first; i < last; i++) {
+        area += (values[i] + values[i+1])/2;
+    }
+    return (first == last) ? values[last] : (int)(area/(last - first));
+}
+
+static
+void
+test_history_long(
+    void)
+{
+    int values[2000];
+    const int max_size = 64;
+    const int n = G_N_ELEMENTS(values);
+    GUtilIntHistory* h = gutil_int_history_new_full(max_size, n,
+        test_history_time_func);
+    int i;
+
+    for (i = 0; i < n; i++) {
+        const int first = MAX(i - max_size + 1, 0);
+
+        /* Replace every other value to shake things up */
+        values[i] = (i * 7919) % 1000;
+        test_history_time = i;
+        if (i % 2) {
+            gutil_int_history_add(h, -values[i]);
+        }
+        g_assert_cmpint(gutil_int_history_add(h, values[i]), == ,
+            test_history_long_median(values, first, i));
+        g_assert_cmpint(gutil_int_history_median(h, 0), == ,
+            test_history_long_median(values, first, i));
+        g_assert_cmpint(gutil_int_history_interval(h), == ,i - first);
+    }
+    gutil_int_history_unref(h);
+}
+
+/*==========================================================================*
+ * Percentile
+ *==========================================================================*/
+
+static
+void
+test_history_percentile(
+    void)
+{
+    GUtilIntHistory* h = gutil_int_history_new_full(4, 3,
+        test_history_time_func);
+
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,-1);
+    test_history_time = 1;
+    gutil_int_history_add(h, 10);
+    g_assert_cmpint(gutil_int_history_percentile(h, 0, -1), == ,10);
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,10);
+    g_assert_cmpint(gutil_int_history_percentile(h, 200, -1), == ,10);
+    /* Time hasn't changed, 10 is replaced with 40 */
+    gutil_int_history_add(h, 40);
+    g_assert_cmpint(gutil_int_history_percentile(h, 100, -1), == ,40);
+    test_history_time++;
+    gutil_int_history_add(h, 20);
+    test_history_time++;
+    gutil_int_history_add(h, 30);
+    /* 20 30 40 */
+    g_assert_cmpint(gutil_int_history_percentile(h, 0, -1), == ,20);
+    g_assert_cmpint(gutil_int_history_percentile(h, 33, -1), == ,20);
+    g_assert_cmpint(gutil_int_history_percentile(h, 34, -1), == ,30);
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,30);
+    g_assert_cmpint(gutil_int_history_percentile(h, 90, -1), == ,40);
+    /* Replace 30 with 10 */
+    gutil_int_history_add(h, 10);
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,20);
+    test_history_time++;
+    gutil_int_history_add(h, 50);
+    test_history_time++;
+    gutil_int_history_add(h, 60);
+    /* 40 is pushed out, 20 10 50 60 remain */
+    g_assert_cmpint(gutil_int_history_percentile(h, 25, -1), == ,10);
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,20);
+    g_assert_cmpint(gutil_int_history_percentile(h, 75, -1), == ,50);
+    test_history_time += 2;
+    /* 20 and 10 expire */
+    g_assert_cmpint(gutil_int_history_percentile(h, 0, -1), == ,50);
+    g_assert_cmpint(gutil_int_history_percentile(h, 99, -1), == ,60);
+    test_history_time += 3;
+    /* Everything expires */
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,-1);
+    gutil_int_history_add(h, 5);
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,5);
+    gutil_int_history_clear(h);
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,-1);
+    gutil_int_history_unref(h);
+
+    /* Single entry history */
+    h = gutil_int_history_new_full(1, 3, test_history_time_func);
+    gutil_int_history_add(h, 1);
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,1);
+    test_history_time++;
+    gutil_int_history_add(h, 2);
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,2);
+    test_history_time--;
+    gutil_int_history_add(h, 3);
+    g_assert_cmpint(gutil_int_history_percentile(h, 50, -1), == ,3);
+    gutil_int_history_unref(h);
+}
+
+static
+int
+test_history_compare_int(
+    gconstpointer a,
+    gconstpointer b)
+{
+    const int* v1 = a;
+    const int* v2 = b;
+
+    return (*v1 > *v2) ? 1 : (*v1 < *v2) ? -1 : 0;
+}
+
+static
+void
+test_history_percentile_long(
+    void)
+{
+    int values[2000];
+    int sorted[100];
+    const int max_size = G_N_ELEMENTS(sorted);
+    const int n = G_N_ELEMENTS(values);
+    GUtilIntHistory* h = gutil_int_history_new_full(max_size, n,
+        test_history_time_func);
+    int i;
+
+    for (i = 0; i < n; i++) {
+        const int first = MAX(i - max_size + 1, 0);
+        const int count = i - first + 1;
+        guint p;
+
+        /* Plenty of duplicates */
+        values[i] = (i * 7919) % 97;
+        test_history_time = i;
+        if (i % 3) {
+            gutil_int_history_add(h, -values[i]);
+        }
+        gutil_int_history_add(h, values[i]);
+        memcpy(sorted, values + first, sizeof(int) * count);
+        qsort(sorted, count, sizeof(int), test_history_compare_int);
+        for (p = 0; p <= 100; p += 5) {
+            const int rank = MAX((int)((p * count + 99) / 100), 1);
+
+            g_assert_cmpint(gutil_int_history_percentile(h, p, 0), == ,
+                sorted[rank - 1]);
+        }
+    }
+    gutil_int_history_unref(h);
+}
+
+/*==========================================================================*
+ * MinMax
+ *==========================================================================*/
+
+static
+void
+test_history_minmax(
+    void)
+{
+    GUtilIntHistory* h = gutil_int_history_new_full(4, 3,
+        test_history_time_func);
+
+    test_history_time = 1;
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,-1);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,-1);
+    gutil_int_history_add(h, 5);
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,5);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,5);
+    test_history_time++;
+    gutil_int_history_add(h, 3);
+    test_history_time++;
+    gutil_int_history_add(h, 8);
+    test_history_time++;
+    gutil_int_history_add(h, 4);
+    /* 5 3 8 4 */
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,3);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,8);
+    /* Replace 4 with 1 and then with 9 */
+    gutil_int_history_add(h, 1);
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,1);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,8);
+    gutil_int_history_add(h, 9);
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,3);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,9);
+    /* Replace 9 with 6 */
+    gutil_int_history_add(h, 6);
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,3);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,8);
+    test_history_time++;
+    gutil_int_history_add(h, 7);
+    /* 5 is pushed out: 3 8 6 7 */
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,3);
+    test_history_time++;
+    /* 3 expires: 8 6 7 */
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,6);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,8);
+    test_history_time++;
+    /* 8 expires: 6 7 */
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,6);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,7);
+    test_history_time += 3;
+    /* Everything expires */
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,-1);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,-1);
+    gutil_int_history_add(h, 2);
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,2);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,2);
+    gutil_int_history_clear(h);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,-1);
+    gutil_int_history_unref(h);
+
+    /* Single entry history */
+    h = gutil_int_history_new_full(1, 3, test_history_time_func);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,-1);
+    gutil_int_history_add(h, 1);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,1);
+    test_history_time++;
+    gutil_int_history_add(h, 2);
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,2);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,2);
+    test_history_time--;
+    gutil_int_history_add(h, 0);
+    g_assert_cmpint(gutil_int_history_min(h, -1), == ,0);
+    g_assert_cmpint(gutil_int_history_max(h, -1), == ,0);
+    gutil_int_history_unref(h);
+}
+
+/*==========================================================================*
+ * Overflow
+ *==========================================================================*/
+
+static
+void
+test_history_overflow(
+    void)
+{
+    GUtilIntHistory* h = gutil_int_history_new_full(2, 2,
+        test_history_time_func);
+
+    test_history_time = 1;
+    g_assert_cmpint(gutil_int_history_add(h, G_MAXINT), == ,G_MAXINT);
+    test_history_time++;
+    g_assert_cmpint(gutil_int_history_add(h, G_MAXINT), == ,G_MAXINT);
+    g_assert_cmpint(gutil_int_history_add(h, G_MININT), == ,0);
+    gutil_int_history_unref(h);
+}
+
+/*==========================================================================*
+ * Int64
+ *==========================================================================*/
+
+static
+void
+test_history_int64(
+    void)
+{
+    const gint64 big = G_GINT64_CONSTANT(1000000000000000000);
+    GUtilInt64History* h = gutil_int64_history_new_full(3, 3,
+        test_history_time_func);
+
+    test_history_time = 1;
+    g_assert(gutil_int64_history_median(h, -1) == -1);
+    g_assert(gutil_int64_history_add(h, big) == big);
+    test_history_time++;
+    g_assert(gutil_int64_history_add(h, 3 * big) == 2 * big);
+    test_history_time++;
+    g_assert(gutil_int64_history_add(h, -big) == 3 * big / 2);
+    gutil_int64_history_unref(gutil_int64_history_ref(h));
+    g_assert_cmpuint(gutil_int64_history_size(h), == ,3);
+    g_assert(gutil_int64_history_interval(h) == 2);
+    g_assert(gutil_int64_history_median(h, -1) == 3 * big / 2);
+    g_assert(gutil_int64_history_percentile(h, 50, 0) == big);
+    g_assert(gutil_int64_history_min(h, 0) == -big);
+    g_assert(gutil_int64_history_max(h, 0) == 3 * big);
+    test_history_time += 2;
+    /* The first entry expires */
+    g_assert(gutil_int64_history_median(h, -1) == big);
+    test_history_time += 3;
+    /* And then the rest */
+    g_assert(gutil_int64_history_median(h, -1) == -1);
+    g_assert(!gutil_int64_history_size(h));
+    gutil_int64_history_add(h, big);
+    gutil_int64_history_clear(h);
+    g_assert(!gutil_int64_history_interval(h));
+    gutil_int64_history_unref(h);
+
+    /* The default time function */
+    h = gutil_int64_history_new(1, 1);
+    g_assert(!gutil_int64_history_size(h));
+    gutil_int64_history_unref(h);
+}
+
+/*==========================================================================*
+ * Double
+ *==========================================================================*/
+
+static
+void
+test_history_double(
+    void)
+{
+    GUtilDoubleHistory* h = gutil_double_history_new_full(16, 10000,
+        test_history_time_func);
+    int i;
+
+    test_history_time = 1;
+    g_assert(gutil_double_history_median(h, -1) == -1);
+    g_assert(gutil_double_history_add(h, 0.5) == 0.5);
+    test_history_time++;
+    g_assert(gutil_double_history_add(h, 1.5) == 1.0);
+    g_assert(gutil_double_history_add(h, 2.5) == 1.5);
+    gutil_double_history_unref(gutil_double_history_ref(h));
+    g_assert_cmpuint(gutil_double_history_size(h), == ,2);
+    g_assert(gutil_double_history_interval(h) == 1);
+    g_assert(gutil_double_history_percentile(h, 50, 0) == 0.5);
+    g_assert(gutil_double_history_min(h, 0) == 0.5);
+    g_assert(gutil_double_history_max(h, 0) == 2.5);
+
+    /* Rounding errors don't accumulate */
+    for (i = 0; i < 1000; i++) {
+        test_history_time++;
+        gutil_double_history_add(h, (i % 2) ? 0.25 : 1e17);
+    }
+    for (i = 0; i < 32; i++) {
+        test_history_time++;
+        gutil_double_history_add(h, 0.25);
+    }
+    g_assert(gutil_double_history_median(h, -1) == 0.25);
+    gutil_double_history_clear(h);
+    g_assert(!gutil_double_history_size(h));
+    gutil_double_history_unref(h);
+
+    /* The default time function */
+    h = gutil_double_history_new(1, 1);
+    g_assert(!gutil_double_history_interval(h));
+    gutil_double_history_unref(h);
+}
+
+/*==========================================================================*
+ * NaN
+ *==========================================================================*/
+
+static
+void
+test_history_nan(
+    void)
+{
+    GUtilDoubleHistory* h = gutil_double_history_new_full(4, 10000,
+        test_history_time_func);
+    int i;
+
+    /* NaN is never stored */
+    test_history_time = 1;
+    g_assert(gutil_double_history_add(h, NAN) == 0);
+    g_assert_cmpuint(gutil_double_history_size(h), == ,0);
+    g_assert(gutil_double_history_percentile(h, 50, -1) == -1);
+    g_assert(gutil_double_history_add(h, 1.0) == 1.0);
+    g_assert(gutil_double_history_add(h, NAN) == 1.0);
+    g_assert(gutil_double_history_min(h, 0) == 1.0);
+    test_history_time++;
+    g_assert(gutil_double_history_add(h, NAN) == 1.0);
+    g_assert_cmpuint(gutil_double_history_size(h), == ,1);
+
+    /* Entries keep expiring (and leaving the tree) normally */
+    for (i = 0; i < 16; i++) {
+        test_history_time++;
+        gutil_double_history_add(h, i);
+        gutil_double_history_add(h, NAN);
+        test_history_time++;
+        gutil_double_history_add(h, NAN);
+        if (i >= 3) {
+            g_assert(gutil_double_history_percentile(h, 50, -1) == i - 2);
+            g_assert(gutil_double_history_min(h, -1) == i - 3);
+            g_assert(gutil_double_history_max(h, -1) == i);
+        }
+    }
+    g_assert_cmpuint(gutil_double_history_size(h), == ,4);
+    g_assert(gutil_double_history_percentile(h, 100, -1) == 15);
+    g_assert(gutil_double_history_percentile(h, 0, -1) == 12);
+    gutil_double_history_unref(h);
+}
+
+/*==========================================================================*
+ * Coarse
+ *==========================================================================*/
+
+static
+void
+test_history_coarse(
+    void)
+{
+    const gint64 t = gutil_history_coarse_time();
+    GUtilIntHistory* h = gutil_int_history_new_full(2, GUTIL_HISTORY_SEC,
+        gutil_history_coarse_time);
+
+    g_assert(t > 0);
+    g_assert(gutil_history_coarse_time() >= t);
+    g_assert_cmpint(gutil_int_history_add(h, 1), == ,1);
+    g_assert_cmpint(gutil_int_history_median(h, 0), == ,1);
+    gutil_int_history_unref(h);
+}
+
+/*==========================================================================*
+ * Expiry
+ *==========================================================================*/
+
+static
+void
+test_history_expiry(
+    void)
+{
+    GUtilIntHistory* h = gutil_int_history_new_full(3, 10,
+        test_history_time_func);
+
+    test_history_time = 100;
+    gutil_int_history_add(h, 1);
+    test_history_time = 105;
+    gutil_int_history_add(h, 2);
+    test_history_time = 107;
+    gutil_int_history_add(h, 3);
+
+    /* Nothing expires until the deadline of the first entry */
+    test_history_time = 110;
+    g_assert_cmpuint(gutil_int_history_size(h), == ,3);
+    g_assert_cmpuint(gutil_int_history_size(h), == ,3);
+    g_assert_cmpint(gutil_int_history_min(h, 0), == ,1);
+
+    /* Then only the first one goes */
+    test_history_time = 111;
+    g_assert_cmpuint(gutil_int_history_size(h), == ,2);
+    g_assert_cmpint(gutil_int_history_min(h, 0), == ,2);
+
+    /* The deadline moves to the next entry */
+    test_history_time = 115;
+    g_assert_cmpuint(gutil_int_history_size(h), == ,2);
+    test_history_time = 116;
+    g_assert_cmpuint(gutil_int_history_size(h), == ,1);
+
+    /* Pushing the first entry out of the ring moves it too */
+    test_history_time = 200;
+    gutil_int_history_add(h, 4);
+    test_history_time = 201;
+    gutil_int_history_add(h, 5);
+    test_history_time = 202;
+    gutil_int_history_add(h, 6);
+    test_history_time = 203;
+    gutil_int_history_add(h, 7);
+    test_history_time = 211;
+    g_assert_cmpuint(gutil_int_history_size(h), == ,3);
+    test_history_time = 212;
+    g_assert_cmpuint(gutil_int_history_size(h), == ,2);
+    test_history_time = 230;
+    g_assert_cmpuint(gutil_int_history_size(h), == ,0);
+    gutil_int_history_unref(h);
+}
+
 /*==========================================================================*
  * Data
  *==========================================================================*/
@@ -282,6 +785,17 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_PREFIX "median", test_history_median);
     g_test_add_func(TEST_PREFIX "size", test_history_size);
     g_test_add_func(TEST_PREFIX "interval", test_history_interval);
+    g_test_add_func(TEST_PREFIX "long", test_history_long);
+    g_test_add_func(TEST_PREFIX "percentile", test_history_percentile);
+    g_test_add_func(TEST_PREFIX "percentile_long",
+        test_history_percentile_long);
+    g_test_add_func(TEST_PREFIX "minmax", test_history_minmax);
+    g_test_add_func(TEST_PREFIX "overflow", test_history_overflow);
+    g_test_add_func(TEST_PREFIX "int64", test_history_int64);
+    g_test_add_func(TEST_PREFIX "double", test_history_double);
+    g_test_add_func(TEST_PREFIX "nan", test_history_nan);
+    g_test_add_func(TEST_PREFIX "coarse", test_history_coarse);
+    g_test_add_func(TEST_PREFIX "expiry", test_history_expiry);
     g_test_add_data_func(TEST_PREFIX "data1", &data1, test_history_data);
     g_test_add_data_func(TEST_PREFIX "data2", &data2, test_history_data);
     g_test_add_data_func(TEST_PREFIX "data3", &data3, test_history_data);
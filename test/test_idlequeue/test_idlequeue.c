@@ -32,6 +32,7 @@
 
 #include "test_common.h"
 
+#include "gutil_histogram.h"
 #include "gutil_idlequeue.h"
 #include "gutil_log.h"
 
@@ -224,6 +225,734 @@ test_idlequeue_cancel(
     gutil_idle_queue_free(q);
 }
 
+/*==========================================================================*
+ * Tags
+ *==========================================================================*/
+
+#define TEST_TAGS_ITEMS (200)
+#define TEST_TAGS_MOD (50)
+
+typedef struct test_idlequeue_tags_data {
+    int ran[TEST_TAGS_ITEMS + 1];
+    int count;
+} TestTags;
+
+static TestTags test_idlequeue_tags_data;
+
+static
+void
+test_idlequeue_tags_cb(
+    gpointer data)
+{
+    TestTags* test = &test_idlequeue_tags_data;
+
+    test->ran[test->count++] = GPOINTER_TO_INT(data);
+}
+
+static
+void
+test_idlequeue_tags(
+    void)
+{
+    static const int cancelled[] = { 7, 57, 50, 13, 63, 113, 163 };
+    TestTags* test = &test_idlequeue_tags_data;
+    GUtilIdleQueue* q = gutil_idle_queue_new();
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    gboolean skip[TEST_TAGS_ITEMS + 2];
+    guint timeout_id = 0;
+    int i, k;
+
+    memset(test, 0, sizeof(*test));
+    for (i = 1; i <= TEST_TAGS_ITEMS; i++) {
+        gutil_idle_queue_add_tag(q, i % TEST_TAGS_MOD,
+            test_idlequeue_tags_cb, GINT_TO_POINTER(i));
+    }
+    gutil_idle_queue_add(q, test_idlequeue_tags_cb,
+        GINT_TO_POINTER(TEST_TAGS_ITEMS + 1));
+
+    /* The oldest item with the matching tag gets cancelled */
+    g_assert(gutil_idle_queue_cancel_tag(q, 7));
+    g_assert(gutil_idle_queue_cancel_tag(q, 7));
+    g_assert(gutil_idle_queue_contains_tag(q, 7));
+
+    /* Untagged items have zero tag */
+    g_assert(gutil_idle_queue_cancel_tag(q, 0));
+    g_assert(gutil_idle_queue_contains_tag(q, 0));
+
+    /* Cancel all items with the same tag */
+    for (i = 0; i < TEST_TAGS_ITEMS / TEST_TAGS_MOD; i++) {
+        g_assert(gutil_idle_queue_contains_tag(q, 13));
+        g_assert(gutil_idle_queue_cancel_tag(q, 13));
+    }
+    g_assert(!gutil_idle_queue_contains_tag(q, 13));
+    g_assert(!gutil_idle_queue_cancel_tag(q, 13));
+    g_assert(!gutil_idle_queue_contains_tag(q, TEST_TAGS_MOD));
+
+    if (!(test_opt.flags & TEST_FLAG_DEBUG)) {
+        timeout_id = g_timeout_add_seconds(TEST_TIMEOUT,
+            test_idlequeue_timeout, NULL);
+    }
+
+    gutil_idle_queue_add(q, test_idlequeue_loop_quit, loop);
+    g_main_loop_run(loop);
+
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    /* The rest must have been run in the original order */
+    g_assert_cmpint(test->count, == ,TEST_TAGS_ITEMS + 1 -
+        G_N_ELEMENTS(cancelled));
+    memset(skip, 0, sizeof(skip));
+    for (i = 0; i < (int)G_N_ELEMENTS(cancelled); i++) {
+        skip[cancelled[i]] = TRUE;
+    }
+    for (i = 1, k = 0; i <= TEST_TAGS_ITEMS + 1; i++) {
+        if (!skip[i]) {
+            g_assert_cmpint(test->ran[k], == ,i);
+            k++;
+        }
+    }
+    g_assert(!gutil_idle_queue_contains_tag(q, 0));
+    g_assert(!gutil_idle_queue_contains_tag(q, 1));
+
+    /* Tags which don't recur */
+    for (i = 1; i <= 4 * TEST_TAGS_ITEMS; i++) {
+        gutil_idle_queue_add_tag(q, i, test_idlequeue_noooo, NULL);
+        gutil_idle_queue_add_tag(q, i, test_idlequeue_noooo, NULL);
+        g_assert(gutil_idle_queue_contains_tag(q, i));
+        g_assert(!gutil_idle_queue_contains_tag(q, i - 1));
+        g_assert(gutil_idle_queue_cancel_tag(q, i));
+        g_assert(gutil_idle_queue_cancel_tag(q, i));
+        g_assert(!gutil_idle_queue_contains_tag(q, i));
+    }
+
+    gutil_idle_queue_unref(q);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * Unique
+ *==========================================================================*/
+
+static
+void
+test_idlequeue_unique(
+    void)
+{
+    GUtilIdleQueue* q = gutil_idle_queue_new();
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    guint timeout_id = 0;
+    int ran[4], freed[4];
+
+    memset(ran, 0, sizeof(ran));
+    memset(freed, 0, sizeof(freed));
+
+    /* NULL queue frees the data */
+    g_assert(!gutil_idle_queue_add_unique(NULL, 1, NULL, freed,
+        test_idlequeue_int_inc));
+    g_assert(!gutil_idle_queue_replace(NULL, 1, NULL, freed,
+        test_idlequeue_int_inc));
+    g_assert_cmpint(freed[0], == ,2);
+    freed[0] = 0;
+
+    /* The second one gets dropped */
+    g_assert(gutil_idle_queue_add_unique(q, 1, test_idlequeue_int_inc,
+        ran, NULL));
+    g_assert(!gutil_idle_queue_add_unique(q, 1, test_idlequeue_noooo,
+        freed, test_idlequeue_int_inc));
+    g_assert(!gutil_idle_queue_add_unique(q, 1, test_idlequeue_noooo,
+        NULL, NULL));
+    g_assert_cmpint(freed[0], == ,1);
+
+    /* Replace frees the old data and keeps the position */
+    g_assert(!gutil_idle_queue_replace(q, 2, test_idlequeue_noooo,
+        freed + 1, test_idlequeue_int_inc));
+    gutil_idle_queue_add_tag(q, 3, test_idlequeue_int_inc, ran + 2);
+    g_assert(gutil_idle_queue_replace(q, 2, test_idlequeue_noooo,
+        freed + 2, test_idlequeue_int_inc));
+    g_assert_cmpint(freed[1], == ,1);
+    g_assert(gutil_idle_queue_replace(q, 2, test_idlequeue_int_inc,
+        ran + 1, NULL));
+    g_assert_cmpint(freed[2], == ,1);
+    gutil_idle_queue_add_unique(q, 3, test_idlequeue_loop_quit, loop, NULL);
+    gutil_idle_queue_add_tag(q, 4, test_idlequeue_loop_quit, loop);
+
+    if (!(test_opt.flags & TEST_FLAG_DEBUG)) {
+        timeout_id = g_timeout_add_seconds(TEST_TIMEOUT,
+            test_idlequeue_timeout, NULL);
+    }
+
+    g_main_loop_run(loop);
+    g_assert_cmpint(ran[0], == ,1);
+    g_assert_cmpint(ran[1], == ,1);
+    g_assert_cmpint(ran[2], == ,1);
+    g_assert_cmpint(freed[0], == ,1);
+    g_assert_cmpint(freed[1], == ,1);
+    g_assert_cmpint(freed[2], == ,1);
+
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    gutil_idle_queue_unref(q);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * Reuse
+ *==========================================================================*/
+
+static
+void
+test_idlequeue_reuse(
+    void)
+{
+    GUtilIdleQueue* q = gutil_idle_queue_new();
+    GMainLoop* loop = g_main_loop_new(NULL, TRUE);
+    guint timeout_id = 0;
+    int i, n, count = 0, freed = 0;
+
+    if (!(test_opt.flags & TEST_FLAG_DEBUG)) {
+        timeout_id = g_timeout_add_seconds(TEST_TIMEOUT,
+            test_idlequeue_timeout, NULL);
+    }
+
+    /* Finished and cancelled items get reused */
+    for (n = 1; n <= 3; n++) {
+        for (i = 0; i < 10 * n; i++) {
+            gutil_idle_queue_add_tag_full(q, i % 3, test_idlequeue_int_inc,
+                &count, NULL);
+            gutil_idle_queue_add_full(q, NULL, &freed,
+                test_idlequeue_int_inc);
+        }
+        g_assert(gutil_idle_queue_cancel_tag(q, 1));
+        g_assert(gutil_idle_queue_cancel_tag(q, 2));
+        gutil_idle_queue_add(q, test_idlequeue_loop_quit, loop);
+        g_main_loop_run(loop);
+        g_assert_cmpint(count, == ,10 * n - 2);
+        g_assert_cmpint(freed, == ,10 * n);
+        count = freed = 0;
+    }
+
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    gutil_idle_queue_unref(q);
+    g_main_loop_unref(loop);
+}
+
+/*==========================================================================*
+ * Budget
+ *==========================================================================*/
+
+static
+void
+test_idlequeue_record(
+    gpointer data)
+{
+    GArray* order = data;
+    const int n = order->len;
+
+    g_array_append_val(order, n);
+}
+
+static
+void
+test_idlequeue_spin(
+    gpointer data)
+{
+    const gint64 start = g_get_monotonic_time();
+
+    /* Make sure that the time moves */
+    while (g_get_monotonic_time() <= start + 1) {
+        continue;
+    }
+    test_idlequeue_int_inc(data);
+}
+
+static
+void
+test_idlequeue_budget(
+    void)
+{
+    GUtilIdleQueue* q = gutil_idle_queue_new();
+    GArray* order = g_array_new(FALSE, FALSE, sizeof(int));
+    guint item_hits, time_hits;
+    int i, count = 0;
+
+    gutil_idle_queue_set_budget(NULL, 1, 1);
+    gutil_idle_queue_get_budget_hits(NULL, NULL, NULL);
+    gutil_idle_queue_get_budget_hits(NULL, &item_hits, &time_hits);
+    g_assert_cmpuint(item_hits, == ,0);
+    g_assert_cmpuint(time_hits, == ,0);
+
+    /* Three items per dispatch */
+    gutil_idle_queue_set_budget(q, 3, 0);
+    for (i = 0; i < 10; i++) {
+        gutil_idle_queue_add(q, test_idlequeue_record, order);
+    }
+    g_assert(g_main_context_iteration(NULL, FALSE));
+    g_assert_cmpuint(order->len, == ,3);
+    while (gutil_idle_queue_contains_tag(q, 0)) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpuint(order->len, == ,10);
+    for (i = 0; i < 10; i++) {
+        g_assert_cmpint(g_array_index(order, int, i), == ,i);
+    }
+    gutil_idle_queue_get_budget_hits(q, &item_hits, NULL);
+    g_assert_cmpuint(item_hits, == ,3);
+
+    /* One item per dispatch, since each takes longer than that */
+    gutil_idle_queue_set_budget(q, 0, 1);
+    for (i = 0; i < 3; i++) {
+        gutil_idle_queue_add(q, test_idlequeue_spin, &count);
+    }
+    g_assert(g_main_context_iteration(NULL, FALSE));
+    g_assert_cmpint(count, == ,1);
+    while (gutil_idle_queue_contains_tag(q, 0)) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpint(count, == ,3);
+    gutil_idle_queue_get_budget_hits(q, &item_hits, &time_hits);
+    g_assert_cmpuint(item_hits, == ,3);
+    g_assert_cmpuint(time_hits, == ,2);
+
+    gutil_idle_queue_unref(q);
+    g_array_free(order, TRUE);
+}
+
+/*==========================================================================*
+ * Priority
+ *==========================================================================*/
+
+typedef struct test_idlequeue_priority_data {
+    GUtilIdleQueue* q;
+    GString* order;
+} TestPriority;
+
+static TestPriority test_idlequeue_priority_data;
+
+static
+void
+test_idlequeue_priority_cb(
+    gpointer data)
+{
+    g_string_append_c(test_idlequeue_priority_data.order,
+        (char)GPOINTER_TO_INT(data));
+}
+
+static
+void
+test_idlequeue_priority_add_cb(
+    gpointer data)
+{
+    TestPriority* test = &test_idlequeue_priority_data;
+
+    /* A higher priority item interrupts the dispatch */
+    test_idlequeue_priority_cb(data);
+    gutil_idle_queue_add_priority(test->q, GUTIL_IDLE_QUEUE_PRIORITY_HIGH,
+        0, test_idlequeue_priority_cb, GINT_TO_POINTER('Y'), NULL);
+}
+
+static
+gboolean
+test_idlequeue_priority_idle(
+    gpointer data)
+{
+    /* Another G_PRIORITY_DEFAULT_IDLE source */
+    (*(int*)data)++;
+    return G_SOURCE_REMOVE;
+}
+
+static
+void
+test_idlequeue_priority(
+    void)
+{
+    TestPriority* test = &test_idlequeue_priority_data;
+    GUtilIdleQueue* q = gutil_idle_queue_new();
+    int i = 0;
+
+    test->q = q;
+    test->order = g_string_new(NULL);
+    gutil_idle_queue_add_priority(NULL, GUTIL_IDLE_QUEUE_PRIORITY_HIGH, 0,
+        NULL, &i, test_idlequeue_int_inc);
+    g_assert_cmpint(i, == ,1);
+
+    /* Higher priority first, FIFO within the same priority */
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_LOW, 0,
+        test_idlequeue_priority_cb, GINT_TO_POINTER('a'), NULL);
+    gutil_idle_queue_add_tag(q, 1, test_idlequeue_priority_cb,
+        GINT_TO_POINTER('b'));
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_HIGH, 2,
+        test_idlequeue_priority_cb, GINT_TO_POINTER('c'), NULL);
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_HIGH, 3,
+        test_idlequeue_noooo, NULL, NULL);
+    gutil_idle_queue_add_priority(q, (GUTIL_IDLE_QUEUE_PRIORITY)-1, 0,
+        test_idlequeue_priority_cb, GINT_TO_POINTER('d'), NULL);
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_LOW, 0,
+        test_idlequeue_priority_cb, GINT_TO_POINTER('e'), NULL);
+    g_assert(gutil_idle_queue_cancel_tag(q, 3));
+
+    /* Each class is dispatched at its own priority */
+    g_idle_add(test_idlequeue_priority_idle, &i);
+    g_assert(g_main_context_iteration(NULL, FALSE));
+    g_assert_cmpstr(test->order->str, == ,"c");
+    g_assert_cmpint(i, == ,1);
+    g_assert(g_main_context_iteration(NULL, FALSE));
+    g_assert_cmpstr(test->order->str, == ,"cbd");
+    g_assert_cmpint(i, == ,2);
+    g_assert(g_main_context_iteration(NULL, FALSE));
+    g_assert_cmpstr(test->order->str, == ,"cbdae");
+    g_assert(!gutil_idle_queue_contains_tag(q, 0));
+    g_string_truncate(test->order, 0);
+
+    /* Cancelling the only high priority item */
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_LOW, 0,
+        test_idlequeue_priority_cb, GINT_TO_POINTER('L'), NULL);
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_HIGH, 1,
+        test_idlequeue_noooo, NULL, NULL);
+    g_assert(gutil_idle_queue_cancel_tag(q, 1));
+    g_assert(g_main_context_iteration(NULL, FALSE));
+    g_assert_cmpstr(test->order->str, == ,"L");
+    g_string_truncate(test->order, 0);
+
+    /* New higher priority item gets invoked before the older ones */
+    gutil_idle_queue_add(q, test_idlequeue_priority_add_cb,
+        GINT_TO_POINTER('X'));
+    gutil_idle_queue_add(q, test_idlequeue_priority_cb,
+        GINT_TO_POINTER('Z'));
+    g_assert(g_main_context_iteration(NULL, FALSE));
+    g_assert_cmpstr(test->order->str, == ,"X");
+    while (gutil_idle_queue_contains_tag(q, 0)) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpstr(test->order->str, == ,"XYZ");
+
+    gutil_idle_queue_unref(q);
+    g_string_free(test->order, TRUE);
+    test->order = NULL;
+    test->q = NULL;
+}
+
+/*==========================================================================*
+ * Submit
+ *==========================================================================*/
+
+#define TEST_SUBMIT_THREADS (4)
+#define TEST_SUBMIT_COUNT (10000)
+
+typedef struct test_idlequeue_submit_data {
+    GUtilIdleQueue* q;
+    int next[TEST_SUBMIT_THREADS];
+    int count;
+} TestSubmit;
+
+typedef struct test_idlequeue_submit_item {
+    TestSubmit* test;
+    int thread;
+    int seq;
+} TestSubmitItem;
+
+static
+void
+test_idlequeue_submit_cb(
+    gpointer data)
+{
+    TestSubmitItem* item = data;
+    TestSubmit* test = item->test;
+
+    /* Submissions from each thread arrive in order */
+    g_assert_cmpint(item->seq, == ,test->next[item->thread]);
+    test->next[item->thread]++;
+    test->count++;
+}
+
+static
+gpointer
+test_idlequeue_submit_thread(
+    gpointer data)
+{
+    TestSubmitItem* item = data;
+    int i;
+
+    /* Ordering is only guaranteed within the same priority */
+    for (i = 0; i < TEST_SUBMIT_COUNT; i++) {
+        gutil_idle_queue_submit(item[i].test->q, (item[i].thread % 2) ?
+            GUTIL_IDLE_QUEUE_PRIORITY_HIGH : GUTIL_IDLE_QUEUE_PRIORITY_LOW,
+            item[i].thread, test_idlequeue_submit_cb, item + i, NULL);
+    }
+    return NULL;
+}
+
+static
+void
+test_idlequeue_submit(
+    void)
+{
+    TestSubmit test;
+    TestSubmitItem* items = g_new(TestSubmitItem, TEST_SUBMIT_THREADS *
+        TEST_SUBMIT_COUNT);
+    GThread* thread[TEST_SUBMIT_THREADS];
+    guint timeout_id = 0;
+    int i, k, freed = 0;
+
+    memset(&test, 0, sizeof(test));
+    test.q = gutil_idle_queue_new();
+    gutil_idle_queue_submit(NULL, GUTIL_IDLE_QUEUE_PRIORITY_DEFAULT, 0,
+        NULL, &freed, test_idlequeue_int_inc);
+    g_assert_cmpint(freed, == ,1);
+
+    if (!(test_opt.flags & TEST_FLAG_DEBUG)) {
+        timeout_id = g_timeout_add_seconds(TEST_TIMEOUT,
+            test_idlequeue_timeout, NULL);
+    }
+
+    /* Threads submit while the main loop is running */
+    for (i = 0; i < TEST_SUBMIT_THREADS; i++) {
+        TestSubmitItem* item = items + i * TEST_SUBMIT_COUNT;
+
+        for (k = 0; k < TEST_SUBMIT_COUNT; k++) {
+            item[k].test = &test;
+            item[k].thread = i;
+            item[k].seq = k;
+        }
+        thread[i] = g_thread_new("test", test_idlequeue_submit_thread, item);
+    }
+
+    while (test.count < TEST_SUBMIT_THREADS * TEST_SUBMIT_COUNT) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    for (i = 0; i < TEST_SUBMIT_THREADS; i++) {
+        g_thread_join(thread[i]);
+    }
+
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    /* Submitted callbacks get cancelled with the queue */
+    gutil_idle_queue_submit(test.q, GUTIL_IDLE_QUEUE_PRIORITY_DEFAULT, 0,
+        test_idlequeue_noooo, &freed, test_idlequeue_int_inc);
+    gutil_idle_queue_unref(test.q);
+    g_assert_cmpint(freed, == ,2);
+    g_free(items);
+}
+
+/*==========================================================================*
+ * Timed
+ *==========================================================================*/
+
+static
+void
+test_idlequeue_timed_cb(
+    gpointer data)
+{
+    g_string_append_c(data, 't');
+}
+
+static
+void
+test_idlequeue_timed_order_cb(
+    gpointer data)
+{
+    g_string_append_c(test_idlequeue_priority_data.order,
+        (char)GPOINTER_TO_INT(data));
+}
+
+static
+void
+test_idlequeue_timed_add_new(
+    gpointer q)
+{
+    /* Adding new timed item from the destroy callback */
+    gutil_idle_queue_add_delayed(q, 1000, 42, test_idlequeue_noooo, NULL,
+        NULL);
+}
+
+static
+void
+test_idlequeue_timed(
+    void)
+{
+    TestPriority* test = &test_idlequeue_priority_data;
+    GUtilIdleQueue* q = gutil_idle_queue_new();
+    GString* str = g_string_new(NULL);
+    const gint64 now = g_get_monotonic_time();
+    guint timeout_id = 0;
+    int freed = 0;
+
+    test->order = g_string_new(NULL);
+    gutil_idle_queue_add_delayed(NULL, 0, 0, NULL, &freed,
+        test_idlequeue_int_inc);
+    gutil_idle_queue_add_deadline(NULL, 0, 0, NULL, &freed,
+        test_idlequeue_int_inc);
+    g_assert_cmpint(freed, == ,2);
+
+    if (!(test_opt.flags & TEST_FLAG_DEBUG)) {
+        timeout_id = g_timeout_add_seconds(TEST_TIMEOUT,
+            test_idlequeue_timeout, NULL);
+    }
+
+    /* Items run in the deadline order, FIFO for the same deadline */
+    gutil_idle_queue_add_deadline(q, now + 30000, 1,
+        test_idlequeue_timed_order_cb, GINT_TO_POINTER('c'), NULL);
+    gutil_idle_queue_add_deadline(q, now + 10000, 0,
+        test_idlequeue_timed_order_cb, GINT_TO_POINTER('a'), NULL);
+    gutil_idle_queue_add_deadline(q, now + 10000, 0,
+        test_idlequeue_timed_order_cb, GINT_TO_POINTER('b'), NULL);
+    gutil_idle_queue_add_deadline(q, now - 1, 3,
+        test_idlequeue_timed_order_cb, GINT_TO_POINTER('X'), NULL);
+    gutil_idle_queue_add(q, test_idlequeue_timed_order_cb,
+        GINT_TO_POINTER('I'));
+
+    /* Pending timed items can be looked up and cancelled by tag */
+    gutil_idle_queue_add_delayed(q, 20, 2, test_idlequeue_noooo, &freed,
+        test_idlequeue_int_inc);
+    g_assert(gutil_idle_queue_contains_tag(q, 1));
+    g_assert(gutil_idle_queue_contains_tag(q, 2));
+    g_assert(!gutil_idle_queue_add_unique(q, 2, test_idlequeue_noooo,
+        &freed, test_idlequeue_int_inc));
+    g_assert_cmpint(freed, == ,3);
+    g_assert(gutil_idle_queue_cancel_tag(q, 2));
+    g_assert_cmpint(freed, == ,4);
+    g_assert(!gutil_idle_queue_contains_tag(q, 2));
+
+    while (test->order->len < 5) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpstr(test->order->str, == ,"IXabc");
+    g_assert(!gutil_idle_queue_contains_tag(q, 0));
+    g_assert(!gutil_idle_queue_contains_tag(q, 1));
+
+    /* Replacing the pending timed item keeps the deadline */
+    gutil_idle_queue_add_delayed(q, 10, 5, test_idlequeue_noooo, &freed,
+        test_idlequeue_int_inc);
+    g_assert(gutil_idle_queue_replace(q, 5, test_idlequeue_timed_cb, str,
+        NULL));
+    g_assert_cmpint(freed, == ,5);
+    while (gutil_idle_queue_contains_tag(q, 5)) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpstr(str->str, == ,"t");
+
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+
+    /* cancel_all destroys the timed items too */
+    gutil_idle_queue_add_delayed(q, 1000, 6, test_idlequeue_noooo, &freed,
+        test_idlequeue_int_inc);
+    gutil_idle_queue_add_delayed(q, 2000, 7, test_idlequeue_noooo, q,
+        test_idlequeue_timed_add_new);
+    gutil_idle_queue_add_delayed(q, 500, 8, test_idlequeue_noooo, &freed,
+        test_idlequeue_int_inc);
+    gutil_idle_queue_cancel_all(q);
+    g_assert_cmpint(freed, == ,7);
+    g_assert(!gutil_idle_queue_contains_tag(q, 6));
+    g_assert(!gutil_idle_queue_contains_tag(q, 7));
+    g_assert(gutil_idle_queue_contains_tag(q, 42));
+
+    /* And so does the last unref */
+    gutil_idle_queue_add_delayed(q, 1000, 9, test_idlequeue_noooo, &freed,
+        test_idlequeue_int_inc);
+    gutil_idle_queue_unref(q);
+    g_assert_cmpint(freed, == ,8);
+    g_string_free(test->order, TRUE);
+    g_string_free(str, TRUE);
+    test->order = NULL;
+}
+
+/*==========================================================================*
+ * Stats
+ *==========================================================================*/
+
+static
+void
+test_idlequeue_stats_sleep(
+    gpointer data)
+{
+    g_usleep(2000);
+}
+
+static
+void
+test_idlequeue_stats_disable(
+    gpointer q)
+{
+    gutil_idle_queue_set_stats_enabled(q, FALSE);
+}
+
+static
+void
+test_idlequeue_stats(
+    void)
+{
+    GUtilIdleQueue* q = gutil_idle_queue_new();
+    GUtilIdleQueueStats stats;
+    int count = 0;
+
+    gutil_idle_queue_set_stats_enabled(NULL, TRUE);
+    gutil_idle_queue_reset_stats(NULL);
+    g_assert(!gutil_idle_queue_get_stats(NULL, NULL));
+    g_assert(!gutil_idle_queue_get_stats(NULL, &stats));
+    g_assert(!stats.wait);
+    g_assert(!stats.run);
+    g_assert(!gutil_idle_queue_get_stats(q, NULL));
+    gutil_idle_queue_reset_stats(q);
+
+    /* The first one is queued before the stats are enabled */
+    gutil_idle_queue_add(q, test_idlequeue_int_inc, &count);
+    gutil_idle_queue_set_stats_enabled(q, TRUE);
+    gutil_idle_queue_set_stats_enabled(q, TRUE);
+    g_assert(gutil_idle_queue_get_stats(q, &stats));
+    g_assert_cmpuint(stats.depth, == ,1);
+    g_assert_cmpuint(stats.max_depth, == ,1);
+    gutil_idle_queue_add(q, test_idlequeue_stats_sleep, NULL);
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_LOW, 0,
+        NULL, NULL, NULL);
+    gutil_idle_queue_submit(q, GUTIL_IDLE_QUEUE_PRIORITY_HIGH, 0,
+        test_idlequeue_int_inc, &count, NULL);
+    gutil_idle_queue_add_delayed(q, 1000, 1, test_idlequeue_noooo,
+        NULL, NULL);
+    g_assert(gutil_idle_queue_get_stats(q, &stats));
+    g_assert_cmpuint(stats.depth, == ,3);
+    g_assert_cmpuint(stats.max_depth, == ,3);
+
+    while (count < 2 || gutil_idle_queue_contains_tag(q, 0)) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert(gutil_idle_queue_get_stats(q, &stats));
+    g_assert_cmpuint(stats.depth, == ,0);
+    g_assert_cmpuint(stats.max_depth, == ,4);
+    g_assert_cmpuint(gutil_histogram_count(stats.wait), == ,3);
+    g_assert_cmpuint(gutil_histogram_count(stats.run), == ,4);
+    g_assert_cmpuint(gutil_histogram_max(stats.run), >= ,2000);
+
+    /* Reset */
+    gutil_idle_queue_reset_stats(q);
+    g_assert(gutil_idle_queue_get_stats(q, &stats));
+    g_assert_cmpuint(stats.max_depth, == ,0);
+    g_assert_cmpuint(gutil_histogram_count(stats.wait), == ,0);
+    g_assert_cmpuint(gutil_histogram_count(stats.run), == ,0);
+
+    /* Stats can be disabled by the callback */
+    gutil_idle_queue_add(q, test_idlequeue_stats_disable, q);
+    gutil_idle_queue_add(q, test_idlequeue_int_inc, &count);
+    while (gutil_idle_queue_contains_tag(q, 0)) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpint(count, == ,3);
+    g_assert(!gutil_idle_queue_get_stats(q, &stats));
+
+    /* And freed together with the queue */
+    gutil_idle_queue_set_stats_enabled(q, TRUE);
+    gutil_idle_queue_unref(q);
+}
+
 /*==========================================================================*
  * CancelAll
  *==========================================================================*/
@@ -264,6 +993,41 @@ test_idlequeue_cancel_all(
     gutil_idle_queue_free(q);
 }
 
+static
+void
+test_idlequeue_cancel_all_add_high(
+    gpointer q)
+{
+    /* The new item is ahead of the ones being cancelled */
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_HIGH, 42,
+        test_idlequeue_noooo, NULL, NULL);
+}
+
+static
+void
+test_idlequeue_cancel_all_priority(
+    void)
+{
+    int count = 0;
+    GUtilIdleQueue* q = gutil_idle_queue_new();
+
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_DEFAULT, 1,
+        NULL, q, test_idlequeue_cancel_all_add_high);
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_DEFAULT, 2,
+        NULL, &count, test_idlequeue_int_inc);
+    gutil_idle_queue_add_priority(q, GUTIL_IDLE_QUEUE_PRIORITY_LOW, 3,
+        NULL, &count, test_idlequeue_int_inc);
+    gutil_idle_queue_cancel_all(q);
+
+    /* All the original items are gone, the new one is still there */
+    g_assert_cmpint(count, == ,2);
+    g_assert(!gutil_idle_queue_contains_tag(q, 1));
+    g_assert(!gutil_idle_queue_contains_tag(q, 2));
+    g_assert(!gutil_idle_queue_contains_tag(q, 3));
+    g_assert(gutil_idle_queue_contains_tag(q, 42));
+    gutil_idle_queue_unref(q);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -281,6 +1045,16 @@ int main(int argc, char* argv[])
     g_test_add_func(TEST_PREFIX "add", test_idlequeue_add);
     g_test_add_func(TEST_PREFIX "cancel", test_idlequeue_cancel);
     g_test_add_func(TEST_PREFIX "cancel_all", test_idlequeue_cancel_all);
+    g_test_add_func(TEST_PREFIX "cancel_all_priority",
+        test_idlequeue_cancel_all_priority);
+    g_test_add_func(TEST_PREFIX "tags", test_idlequeue_tags);
+    g_test_add_func(TEST_PREFIX "unique", test_idlequeue_unique);
+    g_test_add_func(TEST_PREFIX "reuse", test_idlequeue_reuse);
+    g_test_add_func(TEST_PREFIX "budget", test_idlequeue_budget);
+    g_test_add_func(TEST_PREFIX "priority", test_idlequeue_priority);
+    g_test_add_func(TEST_PREFIX "submit", test_idlequeue_submit);
+    g_test_add_func(TEST_PREFIX "timed", test_idlequeue_timed);
+    g_test_add_func(TEST_PREFIX "stats", test_idlequeue_stats);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_common.h"
+
+#include "gutil_rate.h"
+
+static TestOpt test_opt;
+static gint64 test_rate_time;
+static gint test_rate_clock;
+
+#define TEST_SEC GUTIL_HISTORY_SEC
+#define TEST_THREADS (4)
+#define TEST_MARKS (10000)
+
+static
+gint64
+test_rate_time_func(void)
+{
+    return test_rate_time;
+}
+
+static
+gint64
+test_rate_clock_func(void)
+{
+    /* Every call advances the clock */
+    return g_atomic_int_add(&test_rate_clock, 1);
+}
+
+/*==========================================================================*
+ * NULL tolerance
+ *==========================================================================*/
+
+static
+void
+test_rate_null(
+    void)
+{
+    gutil_rate_unref(NULL);
+    gutil_rate_clear(NULL);
+    gutil_rate_mark(NULL, 1);
+    g_assert(!gutil_rate_ref(NULL));
+    g_assert(!gutil_rate_count(NULL));
+    g_assert(gutil_rate_get(NULL) == 0);
+    g_assert(!gutil_rate_new(0, 1));
+    g_assert(!gutil_rate_new(1, 0));
+    g_assert(!gutil_rate_new(1, 2));
+}
+
+/*==========================================================================*
+ * Basic
+ *==========================================================================*/
+
+static
+void
+test_rate_basic(
+    gconstpointer data)
+{
+    const GUTIL_RATE_FLAGS flags = GPOINTER_TO_UINT(data);
+    GUtilRate* r;
+
+    /* The interval is rounded down to 10 one-second buckets */
+    test_rate_time = 100 * TEST_SEC;
+    r = gutil_rate_new_full(10 * TEST_SEC + 5, 10, test_rate_time_func,
+        flags);
+    g_assert(r);
+    g_assert_cmpuint(gutil_rate_count(r), == ,0);
+    g_assert(gutil_rate_get(r) == 0);
+    gutil_rate_unref(gutil_rate_ref(r));
+
+    /* At least one bucket is assumed to be covered */
+    gutil_rate_mark(r, 3);
+    gutil_rate_mark(r, 0);
+    g_assert_cmpuint(gutil_rate_count(r), == ,3);
+    g_assert_cmpfloat(gutil_rate_get(r), == ,3);
+    test_rate_time += TEST_SEC / 2;
+    gutil_rate_mark(r, 1);
+    g_assert_cmpuint(gutil_rate_count(r), == ,4);
+    g_assert_cmpfloat(gutil_rate_get(r), == ,4);
+
+    /* The time since start until the whole interval has passed */
+    test_rate_time = 105 * TEST_SEC;
+    gutil_rate_mark(r, 2);
+    g_assert_cmpuint(gutil_rate_count(r), == ,6);
+    g_assert_cmpfloat(gutil_rate_get(r), == ,1.2);
+
+    /* Then the full buckets plus the current partial one */
+    test_rate_time = 110 * TEST_SEC;
+    g_assert_cmpuint(gutil_rate_count(r), == ,2);
+    g_assert_cmpfloat(gutil_rate_get(r), == ,2.0/9);
+    test_rate_time += TEST_SEC / 2;
+    g_assert_cmpfloat(gutil_rate_get(r), == ,2.0/9.5);
+    gutil_rate_mark(r, 2);
+    g_assert_cmpuint(gutil_rate_count(r), == ,4);
+
+    /* Late marks still count if they fit into the window */
+    test_rate_time = 102 * TEST_SEC;
+    gutil_rate_mark(r, 5);
+    test_rate_time = 100 * TEST_SEC;
+    gutil_rate_mark(r, 5);
+    test_rate_time = 110 * TEST_SEC;
+    g_assert_cmpuint(gutil_rate_count(r), == ,9);
+
+    /* Clear starts counting from scratch */
+    gutil_rate_clear(r);
+    g_assert_cmpuint(gutil_rate_count(r), == ,0);
+    gutil_rate_mark(r, 2);
+    test_rate_time += 2 * TEST_SEC;
+    g_assert_cmpfloat(gutil_rate_get(r), == ,1);
+    gutil_rate_unref(r);
+}
+
+/*==========================================================================*
+ * Expire
+ *==========================================================================*/
+
+static
+void
+test_rate_expire(
+    gconstpointer data)
+{
+    const GUTIL_RATE_FLAGS flags = GPOINTER_TO_UINT(data);
+    GUtilRate* r;
+    int i;
+
+    /* Negative time is fine too */
+    test_rate_time = -20 * TEST_SEC - 1;
+    r = gutil_rate_new_full(4 * TEST_SEC, 4, test_rate_time_func, flags);
+    for (i = 0; i < 8; i++) {
+        gutil_rate_mark(r, 1 << i);
+        test_rate_time += TEST_SEC;
+    }
+
+    /* Buckets expire one by one */
+    g_assert_cmpuint(gutil_rate_count(r), == ,0xe0);
+    test_rate_time += TEST_SEC;
+    g_assert_cmpuint(gutil_rate_count(r), == ,0xc0);
+    test_rate_time += TEST_SEC;
+    g_assert_cmpuint(gutil_rate_count(r), == ,0x80);
+
+    /* And all at once after a long pause */
+    gutil_rate_mark(r, 1);
+    test_rate_time += 100 * TEST_SEC;
+    g_assert_cmpuint(gutil_rate_count(r), == ,0);
+    gutil_rate_mark(r, 1);
+    g_assert_cmpuint(gutil_rate_count(r), == ,1);
+    g_assert_cmpfloat(gutil_rate_get(r), == ,0.25);
+    gutil_rate_unref(r);
+}
+
+/*==========================================================================*
+ * Threads
+ *==========================================================================*/
+
+static
+gpointer
+test_rate_thread(
+    gpointer data)
+{
+    GUtilRate* r = data;
+    int i;
+
+    for (i = 0; i < TEST_MARKS; i++) {
+        gutil_rate_mark(r, 1);
+    }
+    return NULL;
+}
+
+static
+void
+test_rate_threads(
+    void)
+{
+    /* Marks span several buckets but all fit into the window */
+    GUtilRate* r = gutil_rate_new_full(10 * TEST_MARKS, 10,
+        test_rate_clock_func, GUTIL_RATE_FLAG_ATOMIC);
+    GThread* thread[TEST_THREADS];
+    int i;
+
+    for (i = 0; i < TEST_THREADS; i++) {
+        thread[i] = g_thread_new("test", test_rate_thread, r);
+    }
+    for (i = 0; i < TEST_THREADS; i++) {
+        g_thread_join(thread[i]);
+    }
+    g_assert_cmpuint(gutil_rate_count(r), == ,TEST_THREADS * TEST_MARKS);
+    gutil_rate_unref(r);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_PREFIX "/rate/"
+
+int main(int argc, char* argv[])
+{
+    const gconstpointer atomic = GUINT_TO_POINTER(GUTIL_RATE_FLAG_ATOMIC);
+    const gconstpointer plain = GUINT_TO_POINTER(GUTIL_RATE_NO_FLAGS);
+
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_PREFIX "null", test_rate_null);
+    g_test_add_data_func(TEST_PREFIX "basic", plain, test_rate_basic);
+    g_test_add_data_func(TEST_PREFIX "basic_atomic", atomic,
+        test_rate_basic);
+    g_test_add_data_func(TEST_PREFIX "expire", plain, test_rate_expire);
+    g_test_add_data_func(TEST_PREFIX "expire_atomic", atomic,
+        test_rate_expire);
+    g_test_add_func(TEST_PREFIX "threads", test_rate_threads);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
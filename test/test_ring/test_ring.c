@@ -54,6 +54,12 @@ test_basic(
     gutil_ring_set_free_func(NULL, NULL);
     gutil_ring_set_free_func(r, NULL);
     gutil_ring_set_free_func(NULL, g_free);
+    gutil_ring_set_flags(NULL, GUTIL_RING_FLAG_OVERWRITE);
+    g_assert(gutil_ring_flags(NULL) == GUTIL_RING_NO_FLAGS);
+    gutil_ring_foreach(NULL, NULL, NULL);
+    gutil_ring_foreach(r, NULL, NULL);
+    gutil_ring_iter_init(NULL, NULL);
+    g_assert(!gutil_ring_iter_next(NULL, NULL));
     gutil_ring_clear(NULL);
     gutil_ring_compact(NULL);
     gutil_ring_reserve(NULL, 0);
@@ -140,6 +146,61 @@ test_put_front(
 
     g_assert(!gutil_ring_get_last(r));
     gutil_ring_unref(r);
+
+    /* Single element buffer */
+    r = gutil_ring_sized_new(1, 1);
+    g_assert(gutil_ring_put_front(r, GINT_TO_POINTER(1)));
+    g_assert(!gutil_ring_put(r, GINT_TO_POINTER(2)));
+    g_assert(gutil_ring_size(r) == 1);
+    g_assert(gutil_ring_get(r) == GINT_TO_POINTER(1));
+    g_assert(!gutil_ring_size(r));
+    g_assert(gutil_ring_put(r, GINT_TO_POINTER(2)));
+    g_assert(gutil_ring_get(r) == GINT_TO_POINTER(2));
+    g_assert(!gutil_ring_get(r));
+
+    /* Overwriting the element inserted by put_front */
+    gutil_ring_set_flags(r, GUTIL_RING_FLAG_OVERWRITE);
+    g_assert(gutil_ring_put_front(r, GINT_TO_POINTER(3)));
+    g_assert(gutil_ring_put(r, GINT_TO_POINTER(4)));
+    g_assert(gutil_ring_size(r) == 1);
+    g_assert(gutil_ring_get(r) == GINT_TO_POINTER(4));
+    gutil_ring_unref(r);
+}
+
+/*==========================================================================*
+ * Flatten
+ *==========================================================================*/
+
+static
+void
+test_flatten(
+    void)
+{
+    int i, size;
+    gpointer* data;
+    GUtilRing* r = gutil_ring_sized_new(4, GUTIL_RING_UNLIMITED_SIZE);
+
+    /* Wrap the contents around, leaving one slot free */
+    for (i=0; i<4; i++) {
+        g_assert(gutil_ring_put(r, GINT_TO_POINTER(i)));
+    }
+    g_assert(gutil_ring_get(r) == GINT_TO_POINTER(0));
+    g_assert(gutil_ring_get(r) == GINT_TO_POINTER(1));
+    g_assert(gutil_ring_put(r, GINT_TO_POINTER(4)));
+
+    data = gutil_ring_flatten(r, &size);
+    g_assert(size == 3);
+    for (i=0; i<size; i++) {
+        g_assert(data[i] == GINT_TO_POINTER(i+2));
+    }
+
+    /* The free slot must still be usable */
+    g_assert(gutil_ring_put(r, GINT_TO_POINTER(5)));
+    for (i=2; i<=5; i++) {
+        g_assert(gutil_ring_get(r) == GINT_TO_POINTER(i));
+    }
+    g_assert(!gutil_ring_size(r));
+    gutil_ring_unref(r);
 }
 
 /*==========================================================================*
@@ -435,6 +496,375 @@ test_free(
     gutil_ring_unref(r);
 }
 
+/*==========================================================================*
+ * FreeReenter
+ *==========================================================================*/
+
+typedef struct test_free_reenter {
+    GUtilRing* r;
+    int data[10];
+    int extra;
+} TestFreeReenter;
+
+static TestFreeReenter test_free_reenter_data;
+
+static
+void
+test_free_reenter_func(
+    gpointer ptr)
+{
+    TestFreeReenter* test = &test_free_reenter_data;
+
+    /* The ring is already empty, except for what's been added here */
+    test_free_func(ptr);
+    if (test->r) {
+        if (ptr == test->data) {
+            g_assert_cmpint(gutil_ring_size(test->r), == ,0);
+            gutil_ring_put(test->r, &test->extra);
+        } else {
+            g_assert_cmpint(gutil_ring_size(test->r), == ,1);
+        }
+    }
+}
+
+static
+void
+test_free_reenter_run(
+    GUtilRing* r)
+{
+    TestFreeReenter* test = &test_free_reenter_data;
+    const int n = G_N_ELEMENTS(test->data);
+    int i;
+
+    memset(test, 0, sizeof(*test));
+    test->r = r;
+
+    /* Make the contents wrap around */
+    for (i = n/2; i < n; i++) {
+        gutil_ring_put(r, test->data + i);
+    }
+    for (i = n/2 - 1; i >= 0; i--) {
+        gutil_ring_put_front(r, test->data + i);
+    }
+    gutil_ring_clear(r);
+    for (i = 0; i < n; i++) {
+        g_assert_cmpint(test->data[i], == ,1);
+    }
+
+    /* The element added by the free function survives */
+    g_assert_cmpint(gutil_ring_size(r), == ,1);
+    g_assert(gutil_ring_get(r) == &test->extra);
+    g_assert(!test->extra);
+
+    /* And the ring is still usable */
+    for (i = 0; i < n; i++) {
+        gutil_ring_put(r, test->data + i);
+    }
+    g_assert(gutil_ring_get(r) == test->data);
+    test->r = NULL;
+    gutil_ring_unref(r);
+    g_assert_cmpint(test->data[0], == ,1);
+    for (i = 1; i < n; i++) {
+        g_assert_cmpint(test->data[i], == ,2);
+    }
+}
+
+static
+void
+test_free_reenter(
+    void)
+{
+    test_free_reenter_run(gutil_ring_new_full(4, GUTIL_RING_UNLIMITED_SIZE,
+        test_free_reenter_func));
+    test_free_reenter_run(gutil_ring_segmented_new(4,
+        GUTIL_RING_UNLIMITED_SIZE, test_free_reenter_func));
+}
+
+/*==========================================================================*
+ * Overwrite
+ *==========================================================================*/
+
+static
+void
+test_overwrite(
+    void)
+{
+    int data[8];
+    const int n = G_N_ELEMENTS(data);
+    const int limit = 3;
+    int i;
+    GUtilRing* r = gutil_ring_new_full(0, limit, test_free_func);
+
+    memset(data, 0, sizeof(data));
+    g_assert(gutil_ring_flags(r) == GUTIL_RING_NO_FLAGS);
+    for (i=0; i<limit; i++) {
+        g_assert(gutil_ring_put(r, data + i));
+    }
+
+    /* Without the flag the ring refuses to take more */
+    g_assert(!gutil_ring_can_put(r, 1));
+    g_assert(!gutil_ring_put(r, data + limit));
+
+    gutil_ring_set_flags(r, GUTIL_RING_FLAG_OVERWRITE);
+    g_assert(gutil_ring_flags(r) == GUTIL_RING_FLAG_OVERWRITE);
+    g_assert(gutil_ring_can_put(r, 1));
+    g_assert(gutil_ring_can_put(r, limit));
+    g_assert(!gutil_ring_can_put(r, limit + 1));
+    for (i=limit; i<n; i++) {
+        g_assert(gutil_ring_put(r, data + i));
+        g_assert(gutil_ring_size(r) == limit);
+    }
+
+    /* Evicted elements have been freed, the rest are still there */
+    for (i=0; i<n; i++) {
+        g_assert(data[i] == ((i < (n - limit)) ? 1 : 0));
+    }
+    for (i=0; i<limit; i++) {
+        g_assert(gutil_ring_data_at(r, i) == data + (n - limit + i));
+    }
+    gutil_ring_unref(r);
+    for (i=0; i<n; i++) {
+        g_assert(data[i] == 1);
+    }
+
+    /* Buffer larger than the limit */
+    r = gutil_ring_new_full(2*limit, 2*limit, NULL);
+    gutil_ring_set_flags(r, GUTIL_RING_FLAG_OVERWRITE);
+    for (i=0; i<2*limit; i++) {
+        g_assert(gutil_ring_put(r, GINT_TO_POINTER(i)));
+    }
+    gutil_ring_set_max_size(r, limit);
+    g_assert(gutil_ring_size(r) == limit);
+    for (i=2*limit; i<n+limit; i++) {
+        g_assert(gutil_ring_put(r, GINT_TO_POINTER(i)));
+        g_assert(gutil_ring_size(r) == limit);
+    }
+    for (i=0; i<limit; i++) {
+        g_assert(gutil_ring_get(r) == GINT_TO_POINTER(n + i));
+    }
+    g_assert(!gutil_ring_size(r));
+
+    /* Nothing fits into a zero-sized ring */
+    gutil_ring_set_max_size(r, 0);
+    g_assert(!gutil_ring_can_put(r, 1));
+    g_assert(!gutil_ring_put(r, NULL));
+
+    /* And the flag has no effect on unlimited rings */
+    gutil_ring_set_max_size(r, GUTIL_RING_UNLIMITED_SIZE);
+    for (i=0; i<n; i++) {
+        g_assert(gutil_ring_put(r, GINT_TO_POINTER(i)));
+    }
+    g_assert(gutil_ring_size(r) == n);
+    gutil_ring_unref(r);
+}
+
+/*==========================================================================*
+ * Segmented
+ *==========================================================================*/
+
+static
+void
+test_segmented(
+    void)
+{
+    int data[20];
+    const int n = G_N_ELEMENTS(data);
+    const int block = 4;
+    int i, size;
+    gpointer* flat;
+    GUtilRing* r = gutil_ring_segmented_new(block, GUTIL_RING_UNLIMITED_SIZE,
+        test_free_func);
+
+    memset(data, 0, sizeof(data));
+    g_assert(!gutil_ring_get(r));
+    g_assert(!gutil_ring_get_last(r));
+    g_assert(!gutil_ring_flatten(r, &size));
+    g_assert(!size);
+    g_assert(gutil_ring_reserve(r, n));
+
+    /* Fill it from both ends */
+    for (i=n/2; i<n; i++) {
+        g_assert(gutil_ring_put(r, data + i));
+    }
+    for (i=n/2-1; i>=0; i--) {
+        g_assert(gutil_ring_put_front(r, data + i));
+    }
+    g_assert(gutil_ring_size(r) == n);
+    for (i=0; i<n; i++) {
+        g_assert(gutil_ring_data_at(r, i) == data + i);
+    }
+    g_assert(!gutil_ring_data_at(r, n));
+
+    /* Multi-block flatten */
+    flat = gutil_ring_flatten(r, &size);
+    g_assert(size == n);
+    for (i=0; i<n; i++) {
+        g_assert(flat[i] == data + i);
+    }
+
+    /* Take some from both ends */
+    g_assert(gutil_ring_get(r) == data);
+    g_assert(gutil_ring_get_last(r) == data + n - 1);
+    g_assert(gutil_ring_drop(r, block) == block);
+    g_assert(gutil_ring_drop_last(r, block + 1) == block + 1);
+    g_assert(gutil_ring_size(r) == n - 2*block - 3);
+    for (i=0; i<n; i++) {
+        /* Only dropped elements have been freed */
+        g_assert(data[i] == (((i > block && i < n - block - 2) ||
+            i == 0 || i == n - 1) ? 0 : 1));
+    }
+    for (i=0; i<gutil_ring_size(r); i++) {
+        g_assert(gutil_ring_data_at(r, i) == data + block + 1 + i);
+    }
+
+    /* Single block flatten doesn't copy anything */
+    gutil_ring_drop_last(r, gutil_ring_size(r) - 2);
+    flat = gutil_ring_flatten(r, &size);
+    g_assert(size == 2);
+    g_assert(flat[0] == data + block + 1);
+    g_assert(flat[1] == data + block + 2);
+    gutil_ring_compact(r);
+    gutil_ring_compact(r);
+
+    /* Clear frees the rest */
+    gutil_ring_clear(r);
+    g_assert(!gutil_ring_size(r));
+    for (i=0; i<n; i++) {
+        g_assert(data[i] == ((i == 0 || i == n - 1) ? 0 : 1));
+    }
+    gutil_ring_compact(r);
+
+    /* Unref frees what's left */
+    memset(data, 0, sizeof(data));
+    for (i=0; i<n; i++) {
+        g_assert(gutil_ring_put(r, data + i));
+    }
+    gutil_ring_unref(r);
+    for (i=0; i<n; i++) {
+        g_assert(data[i] == 1);
+    }
+
+    /* Limited size and no free function */
+    r = gutil_ring_segmented_new(0, block + 1, NULL);
+    g_assert(gutil_ring_reserve(r, block + 1));
+    g_assert(!gutil_ring_reserve(r, block + 2));
+    for (i=0; i<=block; i++) {
+        g_assert(gutil_ring_put(r, GINT_TO_POINTER(i)));
+    }
+    g_assert(!gutil_ring_put(r, GINT_TO_POINTER(i)));
+    g_assert(!gutil_ring_put_front(r, GINT_TO_POINTER(i)));
+    gutil_ring_set_flags(r, GUTIL_RING_FLAG_OVERWRITE);
+    for (i=block+1; i<n; i++) {
+        g_assert(gutil_ring_put(r, GINT_TO_POINTER(i)));
+    }
+    g_assert(gutil_ring_size(r) == block + 1);
+    for (i=0; i<=block; i++) {
+        g_assert(gutil_ring_get(r) == GINT_TO_POINTER(n - block - 1 + i));
+    }
+    g_assert(!gutil_ring_size(r));
+    for (i=0; i<n; i++) {
+        g_assert(gutil_ring_put(r, GINT_TO_POINTER(i)));
+    }
+    gutil_ring_clear(r);
+    g_assert(!gutil_ring_size(r));
+    gutil_ring_unref(r);
+}
+
+/*==========================================================================*
+ * Foreach
+ *==========================================================================*/
+
+static
+void
+test_foreach_cb(
+    gpointer data,
+    gpointer user_data)
+{
+    GPtrArray* seen = user_data;
+
+    g_ptr_array_add(seen, data);
+}
+
+static
+void
+test_foreach_check(
+    GUtilRing* r)
+{
+    const int n = gutil_ring_size(r);
+    GPtrArray* seen = g_ptr_array_new();
+    GUtilRingIter iter;
+    gpointer data;
+    int i;
+
+    gutil_ring_foreach(r, test_foreach_cb, seen);
+    g_assert_cmpint(seen->len, == ,n);
+    for (i=0; i<n; i++) {
+        g_assert(seen->pdata[i] == gutil_ring_data_at(r, i));
+    }
+
+    i = 0;
+    gutil_ring_iter_init(&iter, r);
+    while (gutil_ring_iter_next(&iter, &data)) {
+        g_assert(data == gutil_ring_data_at(r, i));
+        i++;
+    }
+    g_assert_cmpint(i, == ,n);
+    g_assert(!gutil_ring_iter_next(&iter, &data));
+    g_ptr_array_free(seen, TRUE);
+}
+
+static
+void
+test_foreach(
+    void)
+{
+    int i;
+    const int n = 7;
+    GUtilRing* r = gutil_ring_sized_new(n, n);
+
+    /* Empty */
+    test_foreach_check(r);
+
+    /* Contiguous */
+    for (i=0; i<n-2; i++) {
+        g_assert(gutil_ring_put(r, GINT_TO_POINTER(i + 1)));
+    }
+    test_foreach_check(r);
+
+    /* Wrapped */
+    gutil_ring_drop(r, 3);
+    for (i=0; i<3; i++) {
+        g_assert(gutil_ring_put(r, GINT_TO_POINTER(n + i)));
+    }
+    test_foreach_check(r);
+
+    /* Full and wrapped */
+    g_assert(gutil_ring_put(r, GINT_TO_POINTER(2*n)));
+    g_assert(gutil_ring_put(r, GINT_TO_POINTER(2*n + 1)));
+    g_assert(gutil_ring_size(r) == n);
+    test_foreach_check(r);
+
+    /* Full and not wrapped */
+    gutil_ring_flatten(r, NULL);
+    test_foreach_check(r);
+    gutil_ring_unref(r);
+
+    /* Segmented */
+    r = gutil_ring_segmented_new(3, GUTIL_RING_UNLIMITED_SIZE, NULL);
+    test_foreach_check(r);
+    for (i=0; i<2*n; i++) {
+        g_assert(gutil_ring_put(r, GINT_TO_POINTER(i + 1)));
+        test_foreach_check(r);
+    }
+    g_assert(gutil_ring_put_front(r, GINT_TO_POINTER(2*n + 1)));
+    test_foreach_check(r);
+    while (gutil_ring_size(r) > 0) {
+        gutil_ring_get(r);
+        test_foreach_check(r);
+    }
+    gutil_ring_unref(r);
+}
+
 /*==========================================================================*
  * Common
  *==========================================================================*/
@@ -446,11 +876,16 @@ int main(int argc, char* argv[])
     g_test_init(&argc, &argv, NULL);
     g_test_add_func(TEST_PREFIX "basic", test_basic);
     g_test_add_func(TEST_PREFIX "put_front", test_put_front);
+    g_test_add_func(TEST_PREFIX "flatten", test_flatten);
     g_test_add_func(TEST_PREFIX "drop", test_drop);
     g_test_add_func(TEST_PREFIX "drop_last", test_drop_last);
     g_test_add_func(TEST_PREFIX "max_size", test_max_size);
     g_test_add_func(TEST_PREFIX "limit", test_limit);
     g_test_add_func(TEST_PREFIX "free", test_free);
+    g_test_add_func(TEST_PREFIX "free_reenter", test_free_reenter);
+    g_test_add_func(TEST_PREFIX "overwrite", test_overwrite);
+    g_test_add_func(TEST_PREFIX "segmented", test_segmented);
+    g_test_add_func(TEST_PREFIX "foreach", test_foreach);
     test_init(&test_opt, argc, argv);
     return g_test_run();
 }
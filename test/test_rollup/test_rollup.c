@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "test_common.h"
+
+#include "gutil_rollup.h"
+
+static TestOpt test_opt;
+static gint64 test_rollup_time;
+
+#define TEST_SEC GUTIL_HISTORY_SEC
+#define TEST_MIN (60 * TEST_SEC)
+
+static
+gint64
+test_rollup_time_func(void)
+{
+    return test_rollup_time;
+}
+
+/*==========================================================================*
+ * NULL tolerance
+ *==========================================================================*/
+
+static
+void
+test_rollup_null(
+    void)
+{
+    GUtilRollupStats stats;
+
+    gutil_rollup_unref(NULL);
+    gutil_rollup_clear(NULL);
+    gutil_rollup_add(NULL, 0);
+    g_assert(!gutil_rollup_ref(NULL));
+    g_assert(!gutil_rollup_stats(NULL, 0, NULL));
+    g_assert(!gutil_rollup_stats(NULL, 0, &stats));
+    g_assert(!stats.count);
+    g_assert(!gutil_rollup_new(0, 1, 1));
+    g_assert(!gutil_rollup_new(1, 0, 1));
+    g_assert(!gutil_rollup_new(1, 1, 0));
+}
+
+/*==========================================================================*
+ * Basic
+ *==========================================================================*/
+
+static
+void
+test_rollup_basic(
+    void)
+{
+    GUtilRollup* r = gutil_rollup_new_full(4, 2, 2, test_rollup_time_func);
+    GUtilRollupStats stats;
+
+    test_rollup_time = 10 * TEST_SEC;
+    g_assert(!gutil_rollup_stats(r, TEST_MIN, &stats));
+    gutil_rollup_add(r, 5);
+    test_rollup_time += TEST_SEC / 2;
+    gutil_rollup_add(r, -3);
+    test_rollup_time += TEST_SEC / 2;
+    gutil_rollup_add(r, 7);
+    gutil_rollup_unref(gutil_rollup_ref(r));
+
+    /* The current time only */
+    g_assert(gutil_rollup_stats(r, 0, &stats));
+    g_assert_cmpuint(stats.count, == ,1);
+    g_assert_cmpint(stats.sum, == ,7);
+
+    /* The raw samples are exact */
+    g_assert(gutil_rollup_stats(r, TEST_SEC / 2, &stats));
+    g_assert_cmpuint(stats.count, == ,2);
+    g_assert_cmpint(stats.sum, == ,4);
+    g_assert_cmpint(stats.min, == ,-3);
+    g_assert_cmpint(stats.max, == ,7);
+    g_assert(gutil_rollup_stats(r, G_MAXINT64, NULL));
+
+    /* Time never goes back */
+    test_rollup_time -= TEST_SEC;
+    gutil_rollup_add(r, 1);
+    g_assert(gutil_rollup_stats(r, 0, &stats));
+    g_assert_cmpuint(stats.count, == ,2);
+    g_assert_cmpint(stats.sum, == ,8);
+
+    /* Raw samples become too old, only buckets are left */
+    test_rollup_time = 100 * TEST_SEC;
+    g_assert(gutil_rollup_stats(r, 3 * TEST_MIN, &stats));
+    g_assert_cmpuint(stats.count, == ,4);
+    g_assert_cmpint(stats.sum, == ,10);
+    g_assert_cmpint(stats.min, == ,-3);
+    g_assert_cmpint(stats.max, == ,7);
+
+    /* And expire too */
+    test_rollup_time = 10 * TEST_MIN;
+    g_assert(!gutil_rollup_stats(r, G_MAXINT64, &stats));
+
+    gutil_rollup_clear(r);
+    g_assert(!gutil_rollup_stats(r, G_MAXINT64, &stats));
+    gutil_rollup_unref(r);
+
+    /* The default time function */
+    r = gutil_rollup_new(1, 1, 1);
+    gutil_rollup_add(r, 1);
+    g_assert(gutil_rollup_stats(r, TEST_MIN, &stats));
+    g_assert_cmpuint(stats.count, == ,1);
+    gutil_rollup_unref(r);
+}
+
+/*==========================================================================*
+ * Long
+ *==========================================================================*/
+
+static
+void
+test_rollup_long(
+    gconstpointer data)
+{
+    /* 4 samples per second, during 3 hours */
+    const guint max_samples = GPOINTER_TO_UINT(data);
+    const int n = 3 * 60 * 60 * 4;
+    const gint64 step = TEST_SEC / 4;
+    const gint64 start = 1000 * TEST_SEC;
+    static const gint64 intervals[] = {
+        0, TEST_SEC, 30 * TEST_SEC, TEST_MIN, 5 * TEST_MIN, 59 * TEST_MIN,
+        60 * TEST_MIN, 61 * TEST_MIN, 119 * TEST_MIN
+    };
+    gint64* values = g_new(gint64, n);
+    GUtilRollup* r = gutil_rollup_new_full(max_samples, 3600, 120,
+        test_rollup_time_func);
+    guint k;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        test_rollup_time = start + i * step;
+        values[i] = (i * 7919) % 1000 - 500;
+        gutil_rollup_add(r, values[i]);
+
+        /* At the minute boundaries all intervals are exact */
+        if (!(test_rollup_time % TEST_MIN) && !((i / 240) % 7)) {
+            for (k = 0; k < G_N_ELEMENTS(intervals); k++) {
+                const gint64 cutoff = test_rollup_time - intervals[k];
+                GUtilRollupStats expect, stats;
+                int j;
+
+                memset(&expect, 0, sizeof(expect));
+                for (j = i; j >= 0 && start + j * step >= cutoff; j--) {
+                    const gint64 v = values[j];
+
+                    if (!expect.count) {
+                        expect.min = expect.max = v;
+                    }
+                    expect.count++;
+                    expect.sum += v;
+                    expect.min = MIN(expect.min, v);
+                    expect.max = MAX(expect.max, v);
+                }
+
+                g_assert(gutil_rollup_stats(r, intervals[k], &stats));
+                g_assert_cmpuint(stats.count, == ,expect.count);
+                g_assert_cmpint(stats.sum, == ,expect.sum);
+                g_assert_cmpint(stats.min, == ,expect.min);
+                g_assert_cmpint(stats.max, == ,expect.max);
+            }
+        }
+    }
+    gutil_rollup_unref(r);
+    g_free(values);
+}
+
+/*==========================================================================*
+ * Short seconds level
+ *==========================================================================*/
+
+static
+void
+test_rollup_short(
+    gconstpointer data)
+{
+    /* Per-second level shorter than a minute, one sample per second */
+    const guint seconds = GPOINTER_TO_UINT(data);
+    const int n = 20 * 60;
+    const gint64 start = 1000 * TEST_MIN + 17 * TEST_SEC + TEST_SEC / 2;
+    GUtilRollup* r = gutil_rollup_new_full(100, seconds, 30,
+        test_rollup_time_func);
+    gint64 sum = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        GUtilRollupStats stats;
+
+        test_rollup_time = start + i * TEST_SEC;
+        gutil_rollup_add(r, i);
+        sum += i;
+
+        /* Everything is still there, and nothing is counted twice */
+        g_assert(gutil_rollup_stats(r, 25 * TEST_MIN, &stats));
+        g_assert_cmpuint(stats.count, == ,i + 1);
+        g_assert_cmpint(stats.sum, == ,sum);
+        g_assert_cmpint(stats.min, == ,0);
+        g_assert_cmpint(stats.max, == ,i);
+
+        /* The last minute comes from the raw samples */
+        g_assert(gutil_rollup_stats(r, TEST_MIN - 1, &stats));
+        g_assert_cmpuint(stats.count, == ,MIN(i + 1, 60));
+        g_assert_cmpint(stats.max, == ,i);
+    }
+    gutil_rollup_unref(r);
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_PREFIX "/rollup/"
+
+int main(int argc, char* argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_PREFIX "null", test_rollup_null);
+    g_test_add_func(TEST_PREFIX "basic", test_rollup_basic);
+    g_test_add_data_func(TEST_PREFIX "long", GUINT_TO_POINTER(1000),
+        test_rollup_long);
+    g_test_add_data_func(TEST_PREFIX "overflow", GUINT_TO_POINTER(10),
+        test_rollup_long);
+    g_test_add_data_func(TEST_PREFIX "short1", GUINT_TO_POINTER(1),
+        test_rollup_short);
+    g_test_add_data_func(TEST_PREFIX "short5", GUINT_TO_POINTER(5),
+        test_rollup_short);
+    g_test_add_data_func(TEST_PREFIX "short90", GUINT_TO_POINTER(90),
+        test_rollup_short);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
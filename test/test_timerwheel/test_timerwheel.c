@@ -0,0 +1,433 @@
+/*
+ * Copyright (C) 2026 Slava Monich <slava@monich.com>
+ *
+ * You may use this file under the terms of the BSD license as follows:
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ *   1. Redistributions of source code must retain the above copyright
+ *      notice, this list of conditions and the following disclaimer.
+ *   2. Redistributions in binary form must reproduce the above copyright
+ *      notice, this list of conditions and the following disclaimer in the
+ *      documentation and/or other materials provided with the distribution.
+ *   3. Neither the names of the copyright holders nor the names of its
+ *      contributors may be used to endorse or promote products derived
+ *      from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "test_common.h"
+
+#include "gutil_timerwheel.h"
+#include "gutil_log.h"
+
+#define TEST_TIMEOUT (10) /* seconds */
+
+static TestOpt test_opt;
+
+typedef struct test_timerwheel_data {
+    GUtilTimerWheel* wheel;
+    GString* order;
+    gint64 start;
+} TestTimerWheel;
+
+typedef struct test_timerwheel_item {
+    TestTimerWheel* test;
+    guint timeout_ms;
+    char id;
+} TestTimerWheelItem;
+
+static
+void
+test_timerwheel_noooo(
+    gpointer param)
+{
+    g_assert(!"NOOO!!!");
+}
+
+static
+gboolean
+test_timerwheel_timeout(
+    gpointer param)
+{
+    g_assert(!"TIMEOUT");
+    return G_SOURCE_REMOVE;
+}
+
+static
+void
+test_timerwheel_int_inc(
+    gpointer data)
+{
+    int* ptr = data;
+    (*ptr)++;
+}
+
+static
+void
+test_timerwheel_cb(
+    gpointer data)
+{
+    TestTimerWheelItem* item = data;
+    TestTimerWheel* test = item->test;
+
+    /* Timers never fire early */
+    g_assert_cmpint(g_get_monotonic_time() - test->start, >= ,
+        (gint64)item->timeout_ms * 1000);
+    g_string_append_c(test->order, item->id);
+}
+
+static
+void
+test_timerwheel_add(
+    TestTimerWheel* test,
+    TestTimerWheelItem* item,
+    guint timeout_ms,
+    GUtilTimerWheelTag tag,
+    char id)
+{
+    item->test = test;
+    item->timeout_ms = timeout_ms;
+    item->id = id;
+    gutil_timer_wheel_add(test->wheel, timeout_ms, tag, test_timerwheel_cb,
+        item, NULL);
+}
+
+static
+void
+test_timerwheel_run(
+    TestTimerWheel* test)
+{
+    guint timeout_id = 0;
+
+    if (!(test_opt.flags & TEST_FLAG_DEBUG)) {
+        timeout_id = g_timeout_add_seconds(TEST_TIMEOUT,
+            test_timerwheel_timeout, NULL);
+    }
+    while (gutil_timer_wheel_count(test->wheel)) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+}
+
+static
+void
+test_timerwheel_init(
+    TestTimerWheel* test,
+    guint tick_ms)
+{
+    memset(test, 0, sizeof(*test));
+    test->wheel = gutil_timer_wheel_new(tick_ms);
+    test->order = g_string_new(NULL);
+    test->start = g_get_monotonic_time();
+}
+
+static
+void
+test_timerwheel_deinit(
+    TestTimerWheel* test)
+{
+    gutil_timer_wheel_unref(test->wheel);
+    g_string_free(test->order, TRUE);
+}
+
+/*==========================================================================*
+ * Null
+ *==========================================================================*/
+
+static
+void
+test_timerwheel_null(
+    void)
+{
+    int count = 0;
+
+    gutil_timer_wheel_add(NULL, 0, 0, test_timerwheel_noooo, &count,
+        test_timerwheel_int_inc);
+    g_assert_cmpint(count, == ,1);
+    g_assert(!gutil_timer_wheel_ref(NULL));
+    gutil_timer_wheel_unref(NULL);
+    gutil_timer_wheel_cancel_all(NULL);
+    g_assert(!gutil_timer_wheel_cancel_tag(NULL, 0));
+    g_assert(!gutil_timer_wheel_contains_tag(NULL, 0));
+    g_assert_cmpuint(gutil_timer_wheel_count(NULL), == ,0);
+}
+
+/*==========================================================================*
+ * Basic
+ *==========================================================================*/
+
+static
+void
+test_timerwheel_basic(
+    void)
+{
+    TestTimerWheel test;
+    TestTimerWheelItem item[5];
+    GUtilTimerWheel* wheel;
+
+    test_timerwheel_init(&test, 0);
+    wheel = test.wheel;
+    g_assert(gutil_timer_wheel_ref(wheel) == wheel);
+    gutil_timer_wheel_unref(wheel);
+
+    /* Level 0 and level 1 timers */
+    test_timerwheel_add(&test, item + 0, 100, 1, 'e');
+    test_timerwheel_add(&test, item + 1, 30, 0, 'c');
+    test_timerwheel_add(&test, item + 2, 10, 0, 'b');
+    test_timerwheel_add(&test, item + 3, 70, 0, 'd');
+    test_timerwheel_add(&test, item + 4, 0, 0, 'a');
+    g_assert_cmpuint(gutil_timer_wheel_count(wheel), == ,5);
+    g_assert(gutil_timer_wheel_contains_tag(wheel, 0));
+    g_assert(gutil_timer_wheel_contains_tag(wheel, 1));
+    g_assert(!gutil_timer_wheel_contains_tag(wheel, 2));
+
+    test_timerwheel_run(&test);
+    g_assert_cmpstr(test.order->str, == ,"abcde");
+    g_assert(!gutil_timer_wheel_contains_tag(wheel, 0));
+    g_assert(!gutil_timer_wheel_contains_tag(wheel, 1));
+    test_timerwheel_deinit(&test);
+}
+
+/*==========================================================================*
+ * Tick
+ *==========================================================================*/
+
+static
+void
+test_timerwheel_tick(
+    void)
+{
+    TestTimerWheel test;
+    TestTimerWheelItem item[3];
+
+    /* Coarse ticks, the wheel is idle for a while first */
+    test_timerwheel_init(&test, 25);
+    g_usleep(30000);
+    test.start = g_get_monotonic_time();
+    test_timerwheel_add(&test, item + 0, 60, 0, 'c');
+    test_timerwheel_add(&test, item + 1, 1, 0, 'a');
+    test_timerwheel_add(&test, item + 2, 20, 0, 'b');
+    test_timerwheel_run(&test);
+    g_assert_cmpstr(test.order->str, == ,"abc");
+    test_timerwheel_deinit(&test);
+}
+
+/*==========================================================================*
+ * Cancel
+ *==========================================================================*/
+
+static
+void
+test_timerwheel_cancel_cb(
+    gpointer data)
+{
+    TestTimerWheelItem* item = data;
+
+    /* Cancel the other timer which is due at the same time */
+    test_timerwheel_cb(data);
+    g_assert(gutil_timer_wheel_cancel_tag(item->test->wheel, 3));
+}
+
+static
+void
+test_timerwheel_cancel(
+    void)
+{
+    TestTimerWheel test;
+    TestTimerWheelItem item[4];
+    GUtilTimerWheel* wheel;
+    int count = 0;
+
+    test_timerwheel_init(&test, 20);
+    wheel = test.wheel;
+    g_assert(!gutil_timer_wheel_cancel_tag(wheel, 0));
+    g_assert(!gutil_timer_wheel_cancel_tag(wheel, 1));
+
+    /* The oldest timer with the matching tag gets cancelled */
+    gutil_timer_wheel_add(wheel, 10, 1, test_timerwheel_noooo, &count,
+        test_timerwheel_int_inc);
+    test_timerwheel_add(&test, item + 0, 5, 1, 'a');
+    gutil_timer_wheel_add(wheel, 0, 0, test_timerwheel_noooo, &count,
+        test_timerwheel_int_inc);
+    g_assert(gutil_timer_wheel_cancel_tag(wheel, 1));
+    g_assert_cmpint(count, == ,1);
+    g_assert(gutil_timer_wheel_cancel_tag(wheel, 0));
+    g_assert_cmpint(count, == ,2);
+    g_assert(gutil_timer_wheel_contains_tag(wheel, 1));
+    g_assert(!gutil_timer_wheel_contains_tag(wheel, 0));
+
+    /* Far away timers, including ones beyond the wheel range */
+    gutil_timer_wheel_add(wheel, 3600000, 2, test_timerwheel_noooo, &count,
+        test_timerwheel_int_inc);
+    gutil_timer_wheel_add(wheel, G_MAXUINT, 2, test_timerwheel_noooo,
+        &count, test_timerwheel_int_inc);
+    g_assert_cmpuint(gutil_timer_wheel_count(wheel), == ,3);
+
+    /* A callback cancels the timer due at the same tick */
+    item[1].test = &test;
+    item[1].timeout_ms = 1;
+    item[1].id = 'b';
+    gutil_timer_wheel_add(wheel, 1, 0, test_timerwheel_cancel_cb,
+        item + 1, NULL);
+    gutil_timer_wheel_add(wheel, 1, 3, test_timerwheel_noooo, &count,
+        test_timerwheel_int_inc);
+    test_timerwheel_add(&test, item + 2, 1, 4, 'c');
+
+    while (gutil_timer_wheel_count(wheel) > 2) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpint(count, == ,3);
+    g_assert(gutil_timer_wheel_contains_tag(wheel, 2));
+    g_assert_cmpuint(strlen(test.order->str), == ,3);
+    g_assert(strchr(test.order->str, 'a'));
+    g_assert(strchr(test.order->str, 'b'));
+    g_assert(strchr(test.order->str, 'c'));
+
+    g_assert(gutil_timer_wheel_cancel_tag(wheel, 2));
+    g_assert(gutil_timer_wheel_cancel_tag(wheel, 2));
+    g_assert(!gutil_timer_wheel_cancel_tag(wheel, 2));
+    g_assert_cmpint(count, == ,5);
+    g_assert_cmpuint(gutil_timer_wheel_count(wheel), == ,0);
+
+    /* The pending ones are destroyed with the wheel */
+    test_timerwheel_add(&test, item + 3, 1000, 5, 'd');
+    gutil_timer_wheel_add(wheel, 2000, 6, test_timerwheel_noooo, &count,
+        test_timerwheel_int_inc);
+    test_timerwheel_deinit(&test);
+    g_assert_cmpint(count, == ,6);
+}
+
+/*==========================================================================*
+ * CancelAll
+ *==========================================================================*/
+
+static
+void
+test_timerwheel_cancel_all_add_new(
+    gpointer wheel)
+{
+    /* Adding new timer from the destroy callback */
+    gutil_timer_wheel_add(wheel, 1000, 42, test_timerwheel_noooo, NULL,
+        NULL);
+}
+
+static
+void
+test_timerwheel_cancel_all(
+    void)
+{
+    GUtilTimerWheel* wheel = gutil_timer_wheel_new(1);
+    int count = 0;
+
+    gutil_timer_wheel_cancel_all(wheel);
+    gutil_timer_wheel_add(wheel, 0, 0, test_timerwheel_noooo, &count,
+        test_timerwheel_int_inc);
+    gutil_timer_wheel_add(wheel, 100, 1, test_timerwheel_noooo, &count,
+        test_timerwheel_int_inc);
+    gutil_timer_wheel_add(wheel, 10000, 2, test_timerwheel_noooo, wheel,
+        test_timerwheel_cancel_all_add_new);
+    gutil_timer_wheel_cancel_all(wheel);
+    g_assert_cmpint(count, == ,2);
+
+    /* We should still have 42 in there */
+    g_assert_cmpuint(gutil_timer_wheel_count(wheel), == ,1);
+    g_assert(!gutil_timer_wheel_contains_tag(wheel, 0));
+    g_assert(!gutil_timer_wheel_contains_tag(wheel, 1));
+    g_assert(!gutil_timer_wheel_contains_tag(wheel, 2));
+    g_assert(gutil_timer_wheel_contains_tag(wheel, 42));
+    gutil_timer_wheel_cancel_all(wheel);
+
+    /* Now it has to be really empty */
+    g_assert_cmpuint(gutil_timer_wheel_count(wheel), == ,0);
+    g_assert(!gutil_timer_wheel_contains_tag(wheel, 42));
+    gutil_timer_wheel_unref(wheel);
+}
+
+/*==========================================================================*
+ * Unref
+ *==========================================================================*/
+
+static
+void
+test_timerwheel_unref_cb(
+    gpointer wheel)
+{
+    /* Drop the last reference from the callback */
+    gutil_timer_wheel_unref(wheel);
+}
+
+static
+void
+test_timerwheel_unref(
+    void)
+{
+    GUtilTimerWheel* wheel = gutil_timer_wheel_new(1);
+    guint timeout_id = 0;
+    int count = 0;
+
+    if (!(test_opt.flags & TEST_FLAG_DEBUG)) {
+        timeout_id = g_timeout_add_seconds(TEST_TIMEOUT,
+            test_timerwheel_timeout, NULL);
+    }
+
+    gutil_timer_wheel_add(wheel, 1, 0, test_timerwheel_unref_cb, wheel,
+        NULL);
+    gutil_timer_wheel_add(wheel, 1, 0, test_timerwheel_noooo, &count,
+        test_timerwheel_int_inc);
+    gutil_timer_wheel_add(wheel, 1000, 0, test_timerwheel_noooo, &count,
+        test_timerwheel_int_inc);
+    while (count < 2) {
+        g_main_context_iteration(NULL, TRUE);
+    }
+
+    if (timeout_id) {
+        g_source_remove(timeout_id);
+    }
+}
+
+/*==========================================================================*
+ * Common
+ *==========================================================================*/
+
+#define TEST_PREFIX "/timerwheel/"
+
+int main(int argc, char* argv[])
+{
+    G_GNUC_BEGIN_IGNORE_DEPRECATIONS;
+    g_type_init();
+    G_GNUC_END_IGNORE_DEPRECATIONS;
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func(TEST_PREFIX "null", test_timerwheel_null);
+    g_test_add_func(TEST_PREFIX "basic", test_timerwheel_basic);
+    g_test_add_func(TEST_PREFIX "tick", test_timerwheel_tick);
+    g_test_add_func(TEST_PREFIX "cancel", test_timerwheel_cancel);
+    g_test_add_func(TEST_PREFIX "cancel_all", test_timerwheel_cancel_all);
+    g_test_add_func(TEST_PREFIX "unref", test_timerwheel_unref);
+    test_init(&test_opt, argc, argv);
+    return g_test_run();
+}
+
+/*
+ * Local Variables:
+ * mode: C
+ * c-basic-offset: 4
+ * indent-tabs-mode: nil
+ * End:
+ */